@@ -23,13 +23,16 @@
 #include "DS18B20.h"
 #include "DebugTrace.h"
 
-DebugTrace pc_ds18B20(OFF, TO_SERIAL);
-
 DS18B20::DS18B20(bool crcOn, bool useAddr, bool parasitic, PinName pin) : 
     OneWireThermometer(crcOn, useAddr, parasitic, pin, DS18B20_ID)
 {
 }
 
+DS18B20::DS18B20(bool crcOn, bool useAddr, bool parasitic, PinName tx, PinName rx) : 
+    OneWireThermometer(crcOn, useAddr, parasitic, tx, rx, DS18B20_ID)
+{
+}
+
 void DS18B20::setResolution(eResolution resln)
 {
     // as the write to the configuration register involves a write to the
@@ -64,40 +67,32 @@ void DS18B20::setResolution(eResolution resln)
     }
 }
 
-float DS18B20::calculateTemperature(BYTE* data)
+short DS18B20::calculateTemperature(BYTE* data)
 {
-    bool signBit = false;
-    if (data[TEMPERATURE_MSB] & 0x80) signBit = true;
-        
-    int read_temp = (data[TEMPERATURE_MSB] << 8) + data[TEMPERATURE_LSB];
-    if (signBit)
-    {
-        read_temp = (read_temp ^ 0xFFFF) + 1;    // two's complement
-        read_temp *= -1;
-    }
+    // the register is already two's complement 1/16 deg C
+    short read_temp = (short)((data[TEMPERATURE_MSB] << 8) | data[TEMPERATURE_LSB]);
     
     int resolution = (data[CONFIG_REG_BYTE] & 0x60) >> 5; // mask off bits 6,5 and move to 1,0
     switch (resolution)
     {
         case nineBit:    // 0.5 deg C increments
-            read_temp &= 0xFFF8;                // bits 2,1,0 are undefined
-             pc_ds18B20.traceOut("9 bit resolution ...\r\n");
+            read_temp &= ~0x07;                 // bits 2,1,0 are undefined
+            TRACE_DEBUG("9 bit resolution ...\r\n");
             break;
         case tenBit:     // 0.25 deg C increments
-            read_temp &= 0xFFFC;                // bits 1,0 are undefined
-            pc_ds18B20.traceOut("10 bit resolution ...\r\n");
+            read_temp &= ~0x03;                 // bits 1,0 are undefined
+            TRACE_DEBUG("10 bit resolution ...\r\n");
             break;
         case elevenBit:  // 0.125 deg C increments
-            read_temp &= 0xFFFE;                // bit 0 is undefined
-            pc_ds18B20.traceOut("11 bit resolution ...\r\n");
+            read_temp &= ~0x01;                 // bit 0 is undefined
+            TRACE_DEBUG("11 bit resolution ...\r\n");
             break;
         case twelveBit:  // 0.0625 deg C increments
-            pc_ds18B20.traceOut("12 bit resolution ...\r\n");
+            TRACE_DEBUG("12 bit resolution ...\r\n");
             break;
     }
-    float realTemp = (float)read_temp/16 ;
                  
-    pc_ds18B20.traceOut("TEMP_READ/REAL TEMP: %f \r\n", realTemp); 
+    TRACE_DEBUG("TEMP_READ/REAL TEMP: %d/16 \r\n", (int)read_temp); 
                
-    return realTemp;
+    return read_temp;
 }
\ No newline at end of file
@@ -30,11 +30,12 @@ class DS18B20 : public OneWireThermometer
 {
 public:
     DS18B20(bool crcOn, bool useAddr, bool parasitic, PinName pin);
+    DS18B20(bool crcOn, bool useAddr, bool parasitic, PinName tx, PinName rx);
     
     virtual void setResolution(eResolution resln);
     
 protected:
-    virtual float calculateTemperature(BYTE* data);
+    virtual short calculateTemperature(BYTE* data);
 };
 
 
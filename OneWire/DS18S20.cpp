@@ -23,33 +23,29 @@
 #include "DS18S20.h"
 #include "DebugTrace.h"
 
-DebugTrace pc_ds18S20(ON, TO_SERIAL);
-
 DS18S20::DS18S20(bool crcOn, bool useAddr, bool parasitic, PinName pin) : 
     OneWireThermometer(crcOn, useAddr, parasitic, pin, DS18S20_ID)
 {
 }
 
-float DS18S20::calculateTemperature(BYTE* data)
+DS18S20::DS18S20(bool crcOn, bool useAddr, bool parasitic, PinName tx, PinName rx) : 
+    OneWireThermometer(crcOn, useAddr, parasitic, tx, rx, DS18S20_ID)
+{
+}
+
+short DS18S20::calculateTemperature(BYTE* data)
 {    
-    // DS18S20 basic resolution is always 9 bits, which can be enhanced as follows
-    bool signBit = false;
-    if (data[TEMPERATURE_MSB] & 0x80) signBit = true;
-        
-    int read_temp = (data[TEMPERATURE_MSB] << 8) + data[TEMPERATURE_LSB];
-    if (signBit)
-    {
-        read_temp = (read_temp ^ 0xFFFF) + 1;    // two's complement
-        read_temp *= -1;
-    }
-                 
-    float readTemp = (float)read_temp/2 ;            // divide by 2
-    pc_ds18S20.traceOut("TEMP_READ: %f \r\n", readTemp);     // 9 bit resolution value
+    // DS18S20 basic resolution is always 9 bits (1/2 deg C, two's complement),
+    // which can be enhanced as follows
+    int read_temp = (short)((data[TEMPERATURE_MSB] << 8) | data[TEMPERATURE_LSB]);
+    TRACE_DEBUG("TEMP_READ: %d/2 \r\n", read_temp);     // 9 bit resolution value
+    
+    int countPerDeg = data[COUNT_PER_DEG_BYTE];
+    if (0 == countPerDeg) return read_temp * 8;    // no count data, basic resolution only
                
-    // convert to real temperature
-    float tempCount = float(data[COUNT_PER_DEG_BYTE] - data[COUNT_REMAIN_BYTE])/(float)data[COUNT_PER_DEG_BYTE];        
-    float realTemp = (readTemp - 0.25) + tempCount;        
-    pc_ds18S20.traceOut("Temperature: %f \r\n", realTemp);   // enhanced resolution value
+    // convert to real temperature: TEMP_READ (0.5 bit truncated) - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C
+    int realTemp = (read_temp & ~0x01) * 8 - 4 + ((countPerDeg - data[COUNT_REMAIN_BYTE]) * 16) / countPerDeg;
+    TRACE_DEBUG("Temperature: %d/16 \r\n", realTemp);   // enhanced resolution value
     
     return realTemp;
 }
\ No newline at end of file
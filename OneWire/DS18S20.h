@@ -29,11 +29,12 @@ class DS18S20 : public OneWireThermometer
 {
 public:
     DS18S20(bool crcOn, bool useAddr, bool parasitic, PinName pin);
+    DS18S20(bool crcOn, bool useAddr, bool parasitic, PinName tx, PinName rx);
     
      virtual void setResolution(eResolution resln) {  };    // do nothing
     
 protected:
-    virtual float calculateTemperature(BYTE* data);
+    virtual short calculateTemperature(BYTE* data);
 };
 
 #endif
\ No newline at end of file
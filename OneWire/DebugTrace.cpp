@@ -25,15 +25,17 @@
 #include <stdarg.h>
 #include <string.h>
 
-Serial logSerial(USBTX, USBRX);
-LocalFileSystem local("local");
+// only created when something is actually written, so an unused
+// DebugTrace costs neither a UART nor the local file system
+static Serial* logSerial = NULL;
+static LocalFileSystem* local = NULL;
 
 const char* FILE_PATH = "/local/";
 const char* EXTN = ".bak";
 
 DebugTrace::DebugTrace(eLog on, eLogTarget mode, const char* fileName, int maxSize) :
     enabled(on), logMode(mode), maxFileSize(maxSize), currentFileSize(0),
-    logFileStatus(0)
+    logFileStatus(0), buffered(0)
 {
     // allocate memory for file name strings
     int str_size = (strlen(fileName) + strlen(FILE_PATH) + strlen(EXTN) + 1) * sizeof(char); 
@@ -52,6 +54,8 @@ DebugTrace::DebugTrace(eLog on, eLogTarget mode, const char* fileName, int maxSi
 
 DebugTrace::~DebugTrace()
 {
+    flush();
+    
     // dust to dust, ashes to ashes
     if (logFile != NULL) free(logFile);
     if (logFileBackup != NULL) free(logFileBackup);
@@ -101,43 +105,70 @@ void DebugTrace::traceOut(const char* fmt, ...)
 {
     if (enabled)
     {
+        char line[DEBUGTRACE_LINE];
         va_list ap;            // argument list pointer
         va_start(ap, fmt);
+        int size = vsnprintf(line, sizeof(line), fmt, ap);
+        va_end(ap);
         
-        if (TO_SERIAL == logMode)
-        {
-            vfprintf(logSerial, fmt, ap);
-        }
-        else    // TO_FILE
+        if (size <= 0) return;
+        if (size >= (int)sizeof(line)) size = sizeof(line) - 1;    // truncated
+        
+        // collect output so the serial port or file is only touched when
+        // the buffer is full or flush() is called, not once per trace
+        if (buffered + size > DEBUGTRACE_BUFFER) flush();
+        memcpy(buffer + buffered, line, size);
+        buffered += size;
+    }
+}
+
+void DebugTrace::flush()
+{
+    if (0 == buffered) return;
+    
+    if (TO_SERIAL == logMode)
+    {
+        if (NULL == logSerial) logSerial = new Serial(USBTX, USBRX);
+        for (int i = 0; i < buffered; i++) logSerial->putc(buffer[i]);
+    }
+    else    // TO_FILE
+    {
+        writeFile(buffer, buffered);
+    }
+    
+    buffered = 0;
+}
+
+void DebugTrace::writeFile(const char* data, int size)
+{
+    if (0 == logFileStatus)    // otherwise we failed to remove a full log file
+    {
+        if (NULL == local) local = new LocalFileSystem("local");
+        
+        // Write data to file. Note the file size may go over limit
+        // as we check total size afterwards, using the size written to file.
+        // This is not a big issue, as this mechanism is only here
+        // to stop the file growing unchecked. Just remember log file sizes may
+        // be some what over (as apposed to some what under), so don't push it 
+        // with the max file size.
+        FILE* fp = fopen(logFile, "a");
+        if (NULL == fp) return;
+        int size_written = fwrite(data, 1, size, fp);
+        fclose(fp);
+        
+        // check if we are over the max file size
+        // if so backup file and start again
+        currentFileSize += size_written;
+        if (currentFileSize >= maxFileSize)
         {
-            if (0 == logFileStatus)    // otherwise we failed to remove a full log file
-            {
-                // Write data to file. Note the file size may go over limit
-                // as we check total size afterwards, using the size written to file.
-                // This is not a big issue, as this mechanism is only here
-                // to stop the file growing unchecked. Just remember log file sizes may
-                // be some what over (as apposed to some what under), so don't push it 
-                // with the max file size.
-                FILE* fp = fopen(logFile, "a");
-                if (NULL == fp)
-                {
-                    va_end(ap);
-                    return;
-                }
-                int size_written = vfprintf(fp, fmt, ap);
-                fclose(fp);
-                
-                // check if we are over the max file size
-                // if so backup file and start again
-                currentFileSize += size_written;
-                if (currentFileSize >= maxFileSize)
-                {
-                    backupLog();
-                    currentFileSize = 0;
-                }
-            }
+            backupLog();
+            currentFileSize = 0;
         }
-        
-        va_end(ap);
     }
 }
+
+DebugTrace& traceSink()
+{
+    static DebugTrace sink(ON, DEBUGTRACE_TARGET);
+    return sink;
+}
@@ -26,6 +26,45 @@
 enum eLog {OFF, ON};
 enum eLogTarget {TO_SERIAL, TO_FILE};
 
+// Compile time trace levels. A TRACE_xxx() call above DEBUGTRACE_LEVEL expands
+// to nothing, its arguments are not even evaluated, so a production build
+// carries no logging cost. Set DEBUGTRACE_LEVEL in the build settings.
+#define TRACE_LEVEL_NONE    0
+#define TRACE_LEVEL_ERROR   1       // failures: bad CRC, missing or wrong device
+#define TRACE_LEVEL_INFO    2       // one off events: scans, configuration
+#define TRACE_LEVEL_DEBUG   3       // per byte bus dumps and raw readings
+
+#ifndef DEBUGTRACE_LEVEL
+#define DEBUGTRACE_LEVEL    TRACE_LEVEL_NONE
+#endif
+
+#ifndef DEBUGTRACE_TARGET
+#define DEBUGTRACE_TARGET   TO_SERIAL
+#endif
+
+#define DEBUGTRACE_BUFFER   256     // shared sink buffer, written out when full or flushed
+#define DEBUGTRACE_LINE     80      // longest single trace, longer output is truncated
+
+#if DEBUGTRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(...)    traceSink().traceOut(__VA_ARGS__)
+#define TRACE_FLUSH()       traceSink().flush()
+#else
+#define TRACE_ERROR(...)    ((void)0)
+#define TRACE_FLUSH()       ((void)0)
+#endif
+
+#if DEBUGTRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(...)     traceSink().traceOut(__VA_ARGS__)
+#else
+#define TRACE_INFO(...)     ((void)0)
+#endif
+
+#if DEBUGTRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(...)    traceSink().traceOut(__VA_ARGS__)
+#else
+#define TRACE_DEBUG(...)    ((void)0)
+#endif
+
 class DebugTrace
 {
 public:
@@ -34,6 +73,7 @@ public:
     
     void clear();
     void traceOut(const char* fmt, ...);
+    void flush();               // write out anything buffered by traceOut
     
 private:
     eLog enabled;
@@ -43,8 +83,14 @@ private:
     char* logFile;
     char* logFileBackup;
     int logFileStatus;            // if things go wrong, don't write any more data to file
+    char buffer[DEBUGTRACE_BUFFER];
+    int buffered;
     
     void backupLog();
+    void writeFile(const char* data, int size);
 };
 
+// the one sink shared by all TRACE_xxx() calls, created on first use
+DebugTrace& traceSink();
+
 #endif
@@ -84,82 +84,177 @@ sample code bearing this copyright.
 
 #include "OneWireCRC.h"
 #include "OneWireDefs.h"
+#include "OneWireTiming.h"
 
-// recommended data sheet timings in micro seconds
-const int standardT[] = {6, 64, 60, 10, 9, 55, 0, 480, 70, 410};
-const int overdriveT[] = {1.5, 7.5, 7.5, 2.5, 0.75, 7, 2.5, 70, 8.5, 40};
+// UART transport: a 9600 baud frame gives a reset pulse and presence window,
+// a 115200 baud frame gives one time slot. Only standard speed is supported.
+const int UART_RESET_BAUD = 9600;
+const int UART_SLOT_BAUD = 115200;
+const int UART_RESET_PATTERN = 0xF0;    // start bit + 4 low bits = 520 us low
+const int UART_SLOT_ONE = 0xFF;         // start bit only = 8.7 us low (write '1'/read)
+const int UART_SLOT_ZERO = 0x00;        // start bit + 8 low bits = 78 us low (write '0')
 
-OneWireCRC::OneWireCRC(PinName oneWire, eSpeed speed) : oneWirePort(oneWire)
+OneWireCRC::OneWireCRC(PinName oneWire, eSpeed speed) : uartPort(NULL)
 {
-    if (STANDARD == speed) timing = standardT;   
-    else  timing = overdriveT;  // overdrive
+    oneWirePort = new DigitalInOut(oneWire);
+    
+    cycleCounterInit();
+    setSpeed(speed);
+    clearHealth();
+    
+    resetSearch();    // reset address search state
+}
+
+OneWireCRC::OneWireCRC(PinName tx, PinName rx) : oneWirePort(NULL)
+{
+    uartPort = new Serial(tx, rx);
+    uartPort->format(8, SerialBase::None, 1);
+    pin_mode(tx, OpenDrain);    // let the slaves pull the line low against tx
+    cycleCounterInit();         // not needed for the slots, but users time with it
+    
+    // the UART generates the slots, so overdrive is not available
+    setSpeed(STANDARD);
+    clearHealth();
     
     resetSearch();    // reset address search state
 }
 
-// Generate a 1-wire reset, return 1 if no presence detect was found,
+OneWireCRC::~OneWireCRC()
+{
+    if (oneWirePort != NULL) delete oneWirePort;
+    if (uartPort != NULL) delete uartPort;
+}
+
+// Convert the timing table for the selected speed to core clock cycles,
+// so the slot functions do no arithmetic between edges.
+void OneWireCRC::setSpeed(eSpeed speed)
+{
+    const unsigned int* timing = (STANDARD == speed) ? standardT : overdriveT;
+    
+    currentSpeed = speed;
+    for (int i = 0; i < 10; i++) slotCycles[i] = nsToCycles(timing[i]);
+}
+
+// Generate a 1-wire reset, return 1 if a presence pulse was detected,
 // return 0 otherwise.
 // (NOTE: does not handle alarm presence from DS2404/DS1994)
 int OneWireCRC::reset() 
 {
+    int result = (uartPort != NULL) ? uartReset() : pulseReset();
+    
+    health.resets++;
+    if (!result) health.presenceFailures++;
     
+    return result;
+}
+
+// Interrupts are masked from the release to the presence sample, which must
+// land inside the presence window. At overdrive the reset pulse itself is
+// masked too, H = 70 us is close to the 80 us the devices take as a reset.
+int OneWireCRC::pulseReset()
+{
     BYTE result = 0;    // sample presence pulse result
+    unsigned int start;
+    unsigned int primask = 0;
         
-    wait_us(timing[6]);
-    oneWirePort.output();
-    oneWirePort = 0;
-    wait_us(timing[7]);
-    oneWirePort.input();
-    wait_us(timing[8]);
-    result = !(oneWirePort & 0x01);
-    wait_us(timing[9]);
+    waitCycles(cycleCount(), slotCycles[6]);
+    if (OVERDRIVE == currentSpeed) primask = enterCritical();
+    oneWirePort->output();
+    oneWirePort->write(0);
+    start = cycleCount();
+    waitCycles(start, slotCycles[7]);
+    if (STANDARD == currentSpeed) primask = enterCritical();
+    oneWirePort->input();
+    start = cycleCount();
+    waitCycles(start, slotCycles[8]);
+    result = !(oneWirePort->read() & 0x01);
+    exitCritical(primask);
+    waitCycles(start, slotCycles[8] + slotCycles[9]);
     
     return result;
 }
 
 //
-// Write a bit. Port and bit is used to cut lookup time and provide
-// more certain timing.
+// Write a bit. Timing is measured with the cycle counter from the falling
+// edge, and interrupts are masked while the line is held low: a '1' must be
+// released within 15 us, a '0' within 120 us (16 us at overdrive) or the
+// devices take it as a reset. With power the slot ends with the line driven
+// high, the strong pull-up for a parasite powered device.
 //
-void OneWireCRC::writeBit(int bit)
+void OneWireCRC::writeBit(int bit, bool power)
 {
     bit = bit & 0x01;
     
+    if (uartPort != NULL)
+    {
+        uartTouchBit(bit);
+        return;
+    }
+    
+    unsigned int start;
+    
     if (bit)
     {
         // Write '1' bit
-        oneWirePort.output();
-        oneWirePort = 0;
-        wait_us(timing[0]);
-        oneWirePort.input();
-        wait_us(timing[1]);
+        unsigned int primask = enterCritical();
+        oneWirePort->output();
+        oneWirePort->write(0);
+        start = cycleCount();
+        waitCycles(start, slotCycles[0]);
+        release(power);
+        exitCritical(primask);
+        waitCycles(start, slotCycles[0] + slotCycles[1]);
     }
     else
     {
         // Write '0' bit
-        oneWirePort.output();
-        oneWirePort = 0;
-        wait_us(timing[2]);
-        oneWirePort.input();
-        wait_us(timing[3]);
+        unsigned int primask = enterCritical();
+        oneWirePort->output();
+        oneWirePort->write(0);
+        start = cycleCount();
+        waitCycles(start, slotCycles[2]);
+        release(power);
+        exitCritical(primask);
+        waitCycles(start, slotCycles[2] + slotCycles[3]);
+    }
+}
+
+// End the low phase of a slot: let the line float up, or with power drive
+// it high at once as the strong pull-up, before the recovery time
+void OneWireCRC::release(bool power)
+{
+    if (power)
+    {
+        oneWirePort->write(1);
+    }
+    else
+    {
+        oneWirePort->input();
     }
 }
 
 //
-// Read a bit. Port and bit is used to cut lookup time and provide
-// more certain timing.
+// Read a bit. Interrupts are masked from the falling edge until the line
+// has been sampled, as the sample point must fall within 15 us (2 us at
+// overdrive) of the edge.
 //
 int OneWireCRC::readBit() 
 {
     BYTE result;
+    unsigned int start;
+    
+    if (uartPort != NULL) return uartTouchBit(1);
     
-    oneWirePort.output();
-    oneWirePort = 0;
-    wait_us(timing[0]);
-    oneWirePort.input();
-    wait_us(timing[4]);
-    result = oneWirePort & 0x01;
-    wait_us(timing[5]);
+    unsigned int primask = enterCritical();
+    oneWirePort->output();
+    oneWirePort->write(0);
+    start = cycleCount();
+    waitCycles(start, slotCycles[0]);
+    oneWirePort->input();
+    waitCycles(start, slotCycles[0] + slotCycles[4]);
+    result = oneWirePort->read() & 0x01;
+    exitCritical(primask);
+    waitCycles(start, slotCycles[0] + slotCycles[4] + slotCycles[5]);
        
     return result;
 }
@@ -169,25 +264,45 @@ int OneWireCRC::readBit()
 // pin high, if you need power after the write (e.g. DS18S20 in
 // parasite power mode) then set 'power' to 1, otherwise the pin will
 // go tri-state at the end of the write to avoid heating in a short or
-// other mishap.
+// other mishap. Call depower() to end the strong pull-up.
+// The UART transport can't drive the line high (tx is open drain), so
+// there 'power' is ignored and the pull-up resistor has to do.
 //
-void OneWireCRC::writeByte(int data) 
+void OneWireCRC::writeByte(int data, bool power) 
 {
+    if (uartPort != NULL)
+    {
+        uartTouchByte(data);
+        return;
+    }
+    
     // Loop to write each bit in the byte, LS-bit first
+    // the strong pull-up must be on within 10 us of the end of the last slot,
+    // so the last slot goes straight from low to driven high
     for (int loop = 0; loop < 8; loop++)
     {
-        writeBit(data & 0x01);
+        writeBit(data & 0x01, power && (7 == loop));
         
         // shift the data byte for the next bit
         data >>= 1;
     }
 }
 
+//
+// End a strong pull-up started by writeByte(data, true)
+//
+void OneWireCRC::depower()
+{
+    if (oneWirePort != NULL) oneWirePort->input();
+}
+
 //
 // Read a byte
 //
 int OneWireCRC::readByte() 
 {
+    if (uartPort != NULL) return uartTouchByte(0xFF);
+    
     int result = 0;
     
     for (int loop = 0; loop < 8; loop++)
@@ -204,6 +319,8 @@ int OneWireCRC::readByte()
 
 int OneWireCRC::touchByte(int data)
 {
+    if (uartPort != NULL) return uartTouchByte(data);
+    
     int result = 0;
     
     for (int loop = 0; loop < 8; loop++)
@@ -235,22 +352,75 @@ void OneWireCRC::block(BYTE* data, int data_len)
 
 int OneWireCRC::overdriveSkip(BYTE* data, int data_len)
 {
+    // the UART transport runs at standard speed only
+    if (uartPort != NULL) return 0;
+    
     // set the speed to 'standard'
-    timing = standardT;
+    setSpeed(STANDARD);
     
     // reset all devices
-    if (reset()) return 0;    // if no devices found
+    if (!reset()) return 0;    // if no devices found
     
     // overdrive skip command
     writeByte(OVERDRIVE_SKIP);
     
     // set the speed to 'overdrive'
-    timing = overdriveT;
+    setSpeed(OVERDRIVE);
     
     // do a 1-Wire reset in 'overdrive' and return presence result
     return reset();
 }
 
+//
+// UART transport. The UART's tx and rx are both wired to the bus, so every
+// frame we send is echoed back, with any bits a slave held low read as 0.
+// The slot timing is generated by the UART, so it is not affected by
+// interrupts, and a whole byte of slots is queued before the echoes are
+// collected from the receive FIFO.
+//
+int OneWireCRC::uartReset()
+{
+    // discard anything left over from an earlier transfer
+    while (uartPort->readable()) uartPort->getc();
+    
+    uartPort->baud(UART_RESET_BAUD);
+    uartPort->putc(UART_RESET_PATTERN);
+    int echo = uartPort->getc();
+    uartPort->baud(UART_SLOT_BAUD);
+    
+    // a presence pulse pulls some of the high bits low
+    return (echo != UART_RESET_PATTERN);
+}
+
+int OneWireCRC::uartTouchBit(int bit)
+{
+    uartPort->putc(bit ? UART_SLOT_ONE : UART_SLOT_ZERO);
+    
+    // a '1' slot is only read back as all ones if no slave pulled the line low
+    return (uartPort->getc() == UART_SLOT_ONE) ? 1 : 0;
+}
+
+int OneWireCRC::uartTouchByte(int data)
+{
+    int result = 0;
+    
+    // queue all 8 slots, LS-bit first - the receive FIFO is 16 deep
+    for (int loop = 0; loop < 8; loop++)
+    {
+        uartPort->putc((data & 0x01) ? UART_SLOT_ONE : UART_SLOT_ZERO);
+        data >>= 1;
+    }
+    
+    // then collect the echoes
+    for (int loop = 0; loop < 8; loop++)
+    {
+        result >>= 1;
+        if (uartPort->getc() == UART_SLOT_ONE) result |= 0x80;
+    }
+    
+    return result;
+}
+
 //
 // Do a ROM select
 //
@@ -275,14 +445,78 @@ void OneWireCRC::skipROM()
 //
 void OneWireCRC::resetSearch()
 {
-    searchJunction = -1;
-    searchExhausted = false;
+    lastDiscrepancy = 0;
+    lastFamilyDiscrepancy = 0;
+    lastDeviceFlag = false;
     for (int i = 0; i < 8; i++) 
     {
         address[i] = 0;
     }
 }
 
+//
+// Set the search up so the next search() finds the first device of the
+// given family, if there is one - check the family of what comes back.
+//
+void OneWireCRC::targetSearch(BYTE family)
+{
+    resetSearch();
+    address[0] = family;
+    lastDiscrepancy = 64;
+}
+
+//
+// Set the search up so the next search() skips the rest of the family of
+// the device it last found.
+//
+void OneWireCRC::skipFamily()
+{
+    lastDiscrepancy = lastFamilyDiscrepancy;
+    lastFamilyDiscrepancy = 0;
+    if (0 == lastDiscrepancy) lastDeviceFlag = true;
+}
+
+//
+// Check that a device is still on the bus with one search pass that follows
+// its ROM at every discrepancy. The state of a search in progress is kept,
+// so this can be called between search() calls.
+//
+bool OneWireCRC::verify(BYTE* rom)
+{
+    OneWireSearchState saved;
+    BYTE found[8];
+    bool ok;
+    
+    saveSearch(&saved);
+    for (int i = 0; i < 8; i++) address[i] = rom[i];
+    lastDiscrepancy = 64;
+    lastDeviceFlag = false;
+    
+    ok = searchCommand(found, SEARCH_ROM) && (0 == memcmp(found, rom, 8));
+    
+    restoreSearch(&saved);
+    
+    return ok;
+}
+
+// Keep the place of a search pass, e.g. one OneWireHotPlug has in progress,
+// while another search runs on the bus
+void OneWireCRC::saveSearch(OneWireSearchState* state) const
+{
+    for (int i = 0; i < 8; i++) state->address[i] = address[i];
+    state->lastDiscrepancy = lastDiscrepancy;
+    state->lastFamilyDiscrepancy = lastFamilyDiscrepancy;
+    state->lastDeviceFlag = lastDeviceFlag;
+}
+
+void OneWireCRC::restoreSearch(const OneWireSearchState* state)
+{
+    for (int i = 0; i < 8; i++) address[i] = state->address[i];
+    lastDiscrepancy = state->lastDiscrepancy;
+    lastFamilyDiscrepancy = state->lastFamilyDiscrepancy;
+    lastDeviceFlag = state->lastDeviceFlag;
+}
+
 //
 // Perform a search. If this function returns a '1' then it has
 // enumerated the next device and you may retrieve the ROM from the
@@ -290,70 +524,107 @@ void OneWireCRC::resetSearch()
 // devices, or something horrible happens in the middle of the
 // enumeration then a 0 is returned.  If a new device is found then
 // its address is copied to newAddr.  Use OneWire::reset_search() to
-// start over.
+// start over. The ROM CRC is checked as the bits arrive, so a corrupted
+// address also returns 0.
+// After a 0 the search state is reset, so the following call starts a
+// new pass. The search follows Maxim Application Note 187, which keeps the
+// last discrepancy and a last device flag between calls.
 // 
 BYTE OneWireCRC::search(BYTE* newAddr)
 {
-    BYTE i;
-    int lastJunction = -1;
-    BYTE done = 1;
-    
-    if (searchExhausted) return 0;
-    
-    if (!reset()) return 0;
+    return searchCommand(newAddr, SEARCH_ROM);
+}
+
+//
+// Perform a conditional search: as search(), but only devices whose alarm
+// flag is set take part. For thermometers that is any device whose last
+// conversion was at or above its TH or at or below its TL value.
+//
+BYTE OneWireCRC::alarmSearch(BYTE* newAddr)
+{
+    return searchCommand(newAddr, ALARM_SEARCH);
+}
 
-    writeByte(SEARCH_ROM);
+void OneWireCRC::clearHealth()
+{
+    memset(&health, 0, sizeof(health));
+}
+
+BYTE OneWireCRC::searchCommand(BYTE* newAddr, BYTE command)
+{
+    int lastZero = 0;
+    BYTE crc = 0;
+    BYTE found = 0;
     
-    for(i = 0; i < 64; i++) 
+    if (!lastDeviceFlag)
     {
-        BYTE a = readBit( );
-        BYTE nota = readBit( );
-        BYTE ibyte = i/8;
-        BYTE ibit = 1 << (i & 7);
-    
-        // I don't think this should happen, this means nothing responded, but maybe if
-        // something vanishes during the search it will come up.
-        if (a && nota) return 0;  
-        
-        if (!a && !nota)
+        health.searches++;
+        if (reset())
         {
-            if (i == searchJunction) 
-            {
-                // this is our time to decide differently, we went zero last time, go one.
-                a = 1;
-                searchJunction = lastJunction;
-            } 
-            else if (i < searchJunction) 
+            writeByte(command);
+            
+            int bit;
+            for (bit = 1; bit <= 64; bit++) 
             {
-                // take whatever we took last time, look in address
-                if (address[ibyte] & ibit) a = 1;
-                else 
+                BYTE ibyte = (bit - 1) / 8;
+                BYTE ibit = 1 << ((bit - 1) & 7);
+                BYTE a = readBit();
+                BYTE nota = readBit();
+                BYTE direction;
+            
+                // nothing answered, a device may have been unplugged mid search
+                if (a && nota)
+                {
+                    health.searchErrors++;
+                    break;
+                }
+                
+                if (a != nota)
                 {
-                    // Only 0s count as pending junctions, we've already exhasuted the 0 side of 1s
-                    a = 0;
-                    done = 0;
-                    lastJunction = i;
+                    direction = a;    // every device left has this bit
                 }
-            } 
-            else 
+                else
+                {
+                    // a discrepancy: devices with both values are still in
+                    health.searchCollisions++;
+                    if (bit < lastDiscrepancy) direction = (address[ibyte] & ibit) ? 1 : 0;
+                    else direction = (bit == lastDiscrepancy) ? 1 : 0;
+                    
+                    if (0 == direction)
+                    {
+                        lastZero = bit;
+                        if (lastZero <= 8) lastFamilyDiscrepancy = lastZero;
+                    }
+                }
+                
+                if (direction) address[ibyte] |= ibit;
+                else address[ibyte] &= ~ibit;
+            
+                writeBit(direction);
+                
+                // a byte of the address is complete
+                if (0 == (bit & 7)) crc = crc8Update(crc, address[ibyte]);
+            }
+            
+            // the CRC over the whole address including its CRC byte must be zero
+            if ((bit > 64) && (crc != 0)) health.searchErrors++;
+            if ((bit > 64) && (0 == crc) && (address[0] != 0))
             {
-                // we are blazing new tree, take the 0
-                a = 0;
-                searchJunction = i;
-                done = 0;
+                lastDiscrepancy = lastZero;
+                if (0 == lastDiscrepancy) lastDeviceFlag = true;
+                found = 1;
             }
-            lastJunction = i;
         }
-        
-        if (a) address[ibyte] |= ibit;
-        else address[ibyte] &= ~ibit;
-    
-        writeBit(a);
     }
     
-    if (done) searchExhausted = true;
+    // nothing (more) found: the next call starts a new search
+    if (!found)
+    {
+        resetSearch();
+        return 0;
+    }
     
-    for (i = 0; i < 8; i++) newAddr[i] = address[i];
+    for (int i = 0; i < 8; i++) newAddr[i] = address[i];
     
     return 1;  
 }
@@ -361,11 +632,15 @@ BYTE OneWireCRC::search(BYTE* newAddr)
 // The 1-Wire CRC scheme is described in Maxim Application Note 27:
 // "Understanding and Using Cyclic Redundancy Checks with Maxim iButton Products"
 //
+// crc8Update/crc16Update add one byte to a running CRC, so a CRC can be
+// kept up to date while the bytes come off the bus. Running the CRC over
+// the data and its own CRC byte(s) leaves zero when the data is good.
+//
 
 #if ONEWIRE_CRC8_TABLE
 // This table comes from Dallas sample code where it is freely reusable, 
 // though Copyright (C) 2000 Dallas Semiconductor Corporation
-static BYTE dscrc_table[] = 
+static const BYTE dscrc_table[] = 
 {
       0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65,
     157,195, 33,127,252,162, 64, 30, 95,  1,227,189, 62, 96,130,220,
@@ -384,12 +659,37 @@ static BYTE dscrc_table[] =
     233,183, 85, 11,136,214, 52,106, 43,117,151,201, 74, 20,246,168,
     116, 42,200,150, 21, 75,169,247,182,232, 10, 84,215,137,107, 53};
 
+//
+// Add a byte to a Dallas Semiconductor 8 bit CRC, one table lookup per byte.
+//
+BYTE OneWireCRC::crc8Update(BYTE crc, BYTE data)
+{
+    return dscrc_table[crc ^ data];
+}
+#else
+// The 8 bit CRC of the low and high nibble of a byte. As the CRC is linear
+// the CRC of the byte is the two xor'ed together: 32 bytes instead of 256.
+static const BYTE dscrc_low[16] = 
+{
+      0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65};
+static const BYTE dscrc_high[16] = 
+{
+      0,157, 35,190, 70,219,101,248,140, 17,175, 50,202, 87,233,116};
+
+//
+// Add a byte to a Dallas Semiconductor 8 bit CRC, two nibble lookups per byte.
+//
+BYTE OneWireCRC::crc8Update(BYTE crc, BYTE data)
+{
+    BYTE index = crc ^ data;
+    
+    return dscrc_low[index & 0x0F] ^ dscrc_high[index >> 4];
+}
+#endif
+
 //
 // Compute a Dallas Semiconductor 8 bit CRC. These show up in the ROM
-// and the registers.  (note: this might better be done without the
-// table, it would probably be smaller and certainly fast enough
-// compared to all those delayMicrosecond() calls.  But I got
-// confused, so I use this table from the examples.)  
+// and the registers.
 //
 BYTE OneWireCRC::crc8(BYTE* addr, BYTE len)
 {
@@ -398,62 +698,42 @@ BYTE OneWireCRC::crc8(BYTE* addr, BYTE len)
     
     for (i = 0; i < len; i++)
     {
-        crc  = dscrc_table[crc ^ addr[i] ];
+        crc = crc8Update(crc, addr[i]);
     }
     
     return crc;
 }
-#else
+
+// The 16 bit CRC (x^16 + x^15 + x^2 + 1, reflected) of every nibble value
+static const unsigned short crc16_table[16] = 
+{
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400};
+
 //
-// Compute a Dallas Semiconductor 8 bit CRC directly. 
+// Add a byte to a Dallas Semiconductor 16 bit CRC, low nibble first.
 //
-BYTE OneWireCRC::crc8(BYTE* addr, BYTE len)
+unsigned short OneWireCRC::crc16Update(unsigned short crc, BYTE data)
 {
-    BYTE i, j;
-    BYTE crc = 0;
-    
-    for (i = 0; i < len; i++) 
-    {
-        BYTE inbyte = addr[i];
-        for (j = 0; j < 8; j++) 
-        {
-            BYTE mix = (crc ^ inbyte) & 0x01;
-            crc >>= 1;
-            if (mix) crc ^= 0x8C;
-            inbyte >>= 1;
-        }
-    }
+    crc = (crc >> 4) ^ crc16_table[(crc ^ data) & 0x0F];
+    crc = (crc >> 4) ^ crc16_table[(crc ^ (data >> 4)) & 0x0F];
     
     return crc;
 }
-#endif
-
-static short oddparity[16] = { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
 
 //
-// Compute a Dallas Semiconductor 16 bit CRC. I have never seen one of
-// these, but here it is.
+// Compute a Dallas Semiconductor 16 bit CRC, as used by the memory and
+// counter devices. Note the devices send the inverted CRC, LS-byte first.
 //
-unsigned short OneWireCRC::crc16(unsigned short* data, unsigned short len)
+unsigned short OneWireCRC::crc16(BYTE* data, unsigned short len)
 {
     unsigned short i;
     unsigned short crc = 0;
     
-    for ( i = 0; i < len; i++) 
+    for (i = 0; i < len; i++) 
     {
-        unsigned short cdata = data[len];
-    
-        cdata = (cdata ^ (crc & 0xff)) & 0xff;
-        crc >>= 8;
-    
-        if (oddparity[cdata & 0xf] ^ oddparity[cdata >> 4]) crc ^= 0xc001;
-    
-        cdata <<= 6;
-        crc ^= cdata;
-        cdata <<= 1;
-        crc ^= cdata;
+        crc = crc16Update(crc, data[i]);
     }
     
     return crc;
 }
-
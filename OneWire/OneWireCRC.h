@@ -86,8 +86,10 @@ sample code bearing this copyright.
 #define SNATCH59_ONEWIRECRC_H
 
 #include <mbed.h>
+#include <pinmap.h>
 
-// Select the table-lookup method of computing the 8-bit CRC by setting this to 1
+// Select the 256 byte table-lookup method of computing the 8-bit CRC by setting this to 1,
+// or the 2 x 16 byte nibble table method by setting it to 0
 #ifndef ONEWIRE_CRC8_TABLE
 #define ONEWIRE_CRC8_TABLE 1
 #endif
@@ -96,16 +98,42 @@ typedef unsigned char BYTE;    // used to be uint8_t : something a byte wide, wh
 
 enum eSpeed {OVERDRIVE, STANDARD};
 
+// bus health counters, plain increments so they can stay in the slot code
+struct OneWireBusHealth
+{
+    unsigned int resets;
+    unsigned int presenceFailures;    // reset with no device answering
+    unsigned int searches;
+    unsigned int searchCollisions;    // bit positions where devices disagreed
+    unsigned int searchErrors;        // nobody answered mid search, or a bad ROM CRC
+};
+
+// position of a search pass, to run another search in between and go on after it
+struct OneWireSearchState
+{
+    BYTE address[8];
+    int lastDiscrepancy;
+    int lastFamilyDiscrepancy;
+    bool lastDeviceFlag;
+};
+
 class OneWireCRC
 {
 public:
+    // bit-banged master on a single GPIO pin
     OneWireCRC(PinName oneWire, eSpeed);
+    // UART master: tx must be wired to rx and to the 1-Wire bus (tx is set open drain),
+    // standard speed only
+    OneWireCRC(PinName tx, PinName rx);
+    ~OneWireCRC();
     
     // reset, read, write functions
     int reset();
-    void writeByte(int data);
+    void writeByte(int data, bool power = false);
+    void depower();
     int readByte();
     int touchByte(int data);
+    int readBit();                  // single read slot, e.g. to poll a conversion
     void block(BYTE* data, int data_len);
     int overdriveSkip(BYTE* data, int data_len);
     
@@ -116,23 +144,54 @@ public:
     // address search functions
     void resetSearch();
     BYTE search(BYTE* newAddr);
+    BYTE alarmSearch(BYTE* newAddr);
+    void targetSearch(BYTE family);
+    void skipFamily();
+    bool verify(BYTE* rom);
+    void saveSearch(OneWireSearchState* state) const;
+    void restoreSearch(const OneWireSearchState* state);
 
     // CRC check functions
     static BYTE crc8(BYTE* addr, BYTE len);
-    static unsigned short crc16(unsigned short* data, unsigned short len);
+    static unsigned short crc16(BYTE* data, unsigned short len);
+    
+    // incremental CRC check functions, add one byte to a running CRC
+    static BYTE crc8Update(BYTE crc, BYTE data);
+    static unsigned short crc16Update(unsigned short crc, BYTE data);
+    
+    const OneWireBusHealth& busHealth() const { return health; }
+    void clearHealth();
 
 private:
-    const int* timing;
+    unsigned int slotCycles[10];    // timings A..J in core clock cycles
+    eSpeed currentSpeed;
     
     BYTE address[8];
-    int searchJunction;        // so we can set to it -1 somewhere
-    bool searchExhausted;
+    int lastDiscrepancy;          // search state, see Maxim AN187
+    int lastFamilyDiscrepancy;
+    bool lastDeviceFlag;
+    OneWireBusHealth health;
     
-    DigitalInOut oneWirePort;
+    // transport, only one of these is used - the other is NULL
+    DigitalInOut* oneWirePort;
+    Serial* uartPort;
+    
+    // the transport is owned and deleted by the destructor, so no copies
+    OneWireCRC(const OneWireCRC&);
+    OneWireCRC& operator=(const OneWireCRC&);
+    
+    void setSpeed(eSpeed speed);
+    BYTE searchCommand(BYTE* newAddr, BYTE command);
     
     // read/write bit functions
-    void writeBit(int bit);
-    int readBit();
+    void writeBit(int bit, bool power = false);
+    void release(bool power);
+    int pulseReset();
+    
+    // UART transport functions
+    int uartReset();
+    int uartTouchBit(int bit);
+    int uartTouchByte(int data);
 };
 
 #endif
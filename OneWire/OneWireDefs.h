@@ -53,6 +53,9 @@
 enum eResolution {nineBit = 0, tenBit, elevenBit, twelveBit};
 const int CONVERSION_TIME[] = {94, 188, 375, 750};    // milli-seconds
 
+// temperatures are fixed point, 1/16 deg C (the DS18B20 register format)
+#define TEMPERATURE_INVALID  ((short)0x8000)    // returned when a read fails
+
 // DS18B20/DS18S20 related
 #define TEMPERATURE_LSB    0
 #define TEMPERATURE_MSB    1
@@ -63,4 +66,16 @@ const int CONVERSION_TIME[] = {94, 188, 375, 750};    // milli-seconds
 #define COUNT_REMAIN_BYTE  6
 #define COUNT_PER_DEG_BYTE 7
 
+// value the temperature register holds after power up, before any conversion
+#define POWER_ON_TEMPERATURE (85 * 16)
+
+// Read Scratchpad retries after a CRC failure, the scratchpad keeps its value
+#define READ_RETRIES       2
+
+// read slot interval while polling an externally powered device's conversion
+#define CONVERSION_POLL_US 1000
+
+// EEPROM write time after a Copy Scratchpad
+#define COPYSCRATCH_TIME   10    // milli-seconds
+
 #endif
@@ -0,0 +1,96 @@
+/*
+* OneWireHotPlug. Notices devices being plugged into or pulled from a bus
+* while it is in use, one short bus operation per poll().
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OneWireHotPlug.h"
+
+OneWireHotPlug::OneWireHotPlug(OneWireCRC& bus, BYTE family) :
+    oneWire(bus), family(family), count(0), passStarted(false), checkIndex(-1)
+{
+}
+
+eHotPlugEvent OneWireHotPlug::poll(BYTE* rom)
+{
+    BYTE found[ADDRESS_SIZE];
+
+    if (checkIndex < 0)
+    {
+        if (!passStarted)
+        {
+            // other users of the bus may have searched since, start clean
+            if (family != 0) oneWire.targetSearch(family);
+            else oneWire.resetSearch();
+            passStarted = true;
+        }
+
+        if (oneWire.search(found) && ((0 == family) || (found[0] == family)))
+        {
+            int i = find(found);
+            if (i >= 0)
+            {
+                seen[i] = true;
+                return HOTPLUG_NONE;
+            }
+            if (count >= HOTPLUG_MAX_DEVICES) return HOTPLUG_NONE;
+
+            memcpy(known[count], found, ADDRESS_SIZE);
+            seen[count] = true;
+            count++;
+            memcpy(rom, found, ADDRESS_SIZE);
+            return HOTPLUG_ADDED;
+        }
+
+        // end of the pass (or the end of the family)
+        passStarted = false;
+        checkIndex = 0;
+    }
+
+    // verify the devices the pass missed, one per poll
+    while ((checkIndex < count) && seen[checkIndex]) checkIndex++;
+    if (checkIndex < count)
+    {
+        int i = checkIndex++;
+        if (oneWire.verify(known[i])) return HOTPLUG_NONE;
+
+        memcpy(rom, known[i], ADDRESS_SIZE);
+        retire(i);
+        checkIndex = i;    // the last device moved into this slot
+        return HOTPLUG_REMOVED;
+    }
+
+    for (int i = 0; i < count; i++) seen[i] = false;
+    checkIndex = -1;
+    return HOTPLUG_NONE;
+}
+
+int OneWireHotPlug::find(const BYTE* rom)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (0 == memcmp(known[i], rom, ADDRESS_SIZE)) return i;
+    }
+    return -1;
+}
+
+void OneWireHotPlug::retire(int i)
+{
+    count--;
+    memcpy(known[i], known[count], ADDRESS_SIZE);
+    seen[i] = seen[count];
+}
@@ -0,0 +1,62 @@
+/*
+* OneWireHotPlug. Notices devices being plugged into or pulled from a bus
+* while it is in use, one short bus operation per poll().
+*
+* A search pass is spread over many polls, one search() per call, using the
+* search state OneWireCRC keeps between calls. At the end of a pass every
+* known device the pass did not see gets a Verify of its own before it is
+* retired, so a search upset by other traffic on the bus doesn't drop it.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNATCH59_ONEWIREHOTPLUG_H
+#define SNATCH59_ONEWIREHOTPLUG_H
+
+#include "OneWireCRC.h"
+#include "OneWireDefs.h"
+
+#define HOTPLUG_MAX_DEVICES 8
+
+enum eHotPlugEvent {HOTPLUG_NONE, HOTPLUG_ADDED, HOTPLUG_REMOVED};
+
+class OneWireHotPlug
+{
+public:
+    // family 0 watches every device, otherwise only devices of that family
+    OneWireHotPlug(OneWireCRC& bus, BYTE family = 0);
+
+    // one step, call between samples - returns what changed, if anything,
+    // and copies the ROM of the device concerned to rom
+    eHotPlugEvent poll(BYTE* rom);
+
+    int deviceCount() const { return count; }
+    const BYTE* device(int i) const { return known[i]; }
+
+private:
+    OneWireCRC& oneWire;
+    BYTE family;
+    BYTE known[HOTPLUG_MAX_DEVICES][ADDRESS_SIZE];
+    bool seen[HOTPLUG_MAX_DEVICES];
+    int count;
+    bool passStarted;
+    int checkIndex;        // next device to verify after a pass, -1 while searching
+
+    int find(const BYTE* rom);
+    void retire(int i);
+};
+
+#endif
@@ -0,0 +1,193 @@
+/*
+* OneWireMultiBus. Drives up to 8 separate 1-Wire buses on one GPIO port in
+* lockstep, so a reset, a broadcast or a scratchpad read on every bus takes
+* the time of one.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OneWireMultiBus.h"
+#include "OneWireTiming.h"
+
+OneWireMultiBus::OneWireMultiBus(const PinName* pins, int count, eSpeed speed) :
+    buses(0), allBits(0)
+{
+    // leaving a pin out would move every later bus to the wrong index
+    if ((count < 1) || (count > ONEWIRE_MAX_BUSES))
+    {
+        error("OneWireMultiBus: %d buses, 1 to %d supported\r\n", count, ONEWIRE_MAX_BUSES);
+    }
+
+    PortName portName = (PortName)((pins[0] - P0_0) >> PORT_SHIFT);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (((pins[i] - P0_0) >> PORT_SHIFT) != portName)
+        {
+            error("OneWireMultiBus: bus %d is not on port %d\r\n", i, (int)portName);
+        }
+
+        busBit[buses] = 1 << ((pins[i] - P0_0) & 0x1F);
+        if (allBits & busBit[buses])
+        {
+            error("OneWireMultiBus: bus %d is on the pin of another bus\r\n", i);
+        }
+        allBits |= busBit[buses];
+        buses++;
+    }
+
+    port = new PortInOut(portName, allBits);
+    port->mode(OpenDrain);
+    port->write(allBits);    // released
+    port->output();
+
+    cycleCounterInit();
+
+    busSpeed = speed;
+    const unsigned int* timing = (STANDARD == speed) ? standardT : overdriveT;
+    for (int i = 0; i < 10; i++) slotCycles[i] = nsToCycles(timing[i]);
+}
+
+OneWireMultiBus::~OneWireMultiBus()
+{
+    port->input();
+    delete port;
+}
+
+int OneWireMultiBus::fromPort(int portBits)
+{
+    int busMask = 0;
+    for (int i = 0; i < buses; i++)
+    {
+        if (portBits & busBit[i]) busMask |= 1 << i;
+    }
+    return busMask;
+}
+
+// Same timing and interrupt masking as OneWireCRC::reset(), with the presence pulse sampled on
+// every bus in one port read.
+int OneWireMultiBus::reset()
+{
+    unsigned int start;
+    unsigned int primask = 0;
+    int present;
+
+    waitCycles(cycleCount(), slotCycles[6]);
+    if (OVERDRIVE == busSpeed) primask = enterCritical();
+    port->write(0);
+    start = cycleCount();
+    waitCycles(start, slotCycles[7]);
+    if (STANDARD == busSpeed) primask = enterCritical();
+    port->write(allBits);
+    start = cycleCount();
+    waitCycles(start, slotCycles[8]);
+    present = ~port->read() & allBits;
+    exitCritical(primask);
+    waitCycles(start, slotCycles[8] + slotCycles[9]);
+
+    return fromPort(present);
+}
+
+//
+// Write a bit on every bus: all buses go low together, the '1' buses are
+// released after A and the '0' buses after C. Interrupts are masked until
+// every bus is released, as OneWireCRC::writeBit() does.
+//
+void OneWireMultiBus::writeBits(int ones)
+{
+    unsigned int start;
+
+    unsigned int primask = enterCritical();
+    port->write(0);
+    start = cycleCount();
+    waitCycles(start, slotCycles[0]);
+    port->write(ones);
+    waitCycles(start, slotCycles[2]);
+    port->write(allBits);
+    exitCritical(primask);
+    waitCycles(start, slotCycles[2] + slotCycles[3]);
+}
+
+int OneWireMultiBus::readBits()
+{
+    unsigned int start;
+    int result;
+
+    unsigned int primask = enterCritical();
+    port->write(0);
+    start = cycleCount();
+    waitCycles(start, slotCycles[0]);
+    port->write(allBits);
+    waitCycles(start, slotCycles[0] + slotCycles[4]);
+    result = port->read() & allBits;
+    exitCritical(primask);
+    waitCycles(start, slotCycles[0] + slotCycles[4] + slotCycles[5]);
+
+    return result;
+}
+
+void OneWireMultiBus::writeByte(int data)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        writeBits((data & 0x01) ? allBits : 0);
+        data >>= 1;
+    }
+}
+
+void OneWireMultiBus::skipROM()
+{
+    writeByte(SKIP_ROM);
+}
+
+void OneWireMultiBus::writeBytes(const BYTE* data)
+{
+    for (int bit = 0; bit < 8; bit++)
+    {
+        int ones = 0;
+        for (int i = 0; i < buses; i++)
+        {
+            if (data[i] & (1 << bit)) ones |= busBit[i];
+        }
+        writeBits(ones);
+    }
+}
+
+void OneWireMultiBus::readBytes(BYTE* data)
+{
+    for (int i = 0; i < buses; i++) data[i] = 0;
+
+    for (int bit = 0; bit < 8; bit++)
+    {
+        int ones = readBits();
+        for (int i = 0; i < buses; i++)
+        {
+            if (ones & busBit[i]) data[i] |= 1 << bit;
+        }
+    }
+}
+
+void OneWireMultiBus::matchROM(BYTE (*rom)[ADDRESS_SIZE])
+{
+    BYTE data[ONEWIRE_MAX_BUSES];
+
+    writeByte(MATCH_ROM);
+    for (int n = 0; n < ADDRESS_SIZE; n++)
+    {
+        for (int i = 0; i < buses; i++) data[i] = rom[i][n];
+        writeBytes(data);
+    }
+}
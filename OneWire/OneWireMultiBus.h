@@ -0,0 +1,75 @@
+/*
+* OneWireMultiBus. Drives up to 8 separate 1-Wire buses on one GPIO port in
+* lockstep, so a reset, a broadcast or a scratchpad read on every bus takes
+* the time of one.
+*
+* The pins are set open drain and left as outputs: writing 0 pulls a bus
+* low, writing 1 lets it float up, and reading the port gives the real level
+* of every bus. So each bus can be sent different bits in the same slot, e.g.
+* a different Match ROM address per bus.
+*
+* Bus i is bit i of every mask taken or returned.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNATCH59_ONEWIREMULTIBUS_H
+#define SNATCH59_ONEWIREMULTIBUS_H
+
+#include <mbed.h>
+#include "OneWireCRC.h"
+#include "OneWireDefs.h"
+
+#define ONEWIRE_MAX_BUSES 8
+
+class OneWireMultiBus
+{
+public:
+    // all pins must be on the same port and at most ONEWIRE_MAX_BUSES of them,
+    // any other set of pins is a fatal error() - bus i is always pins[i]
+    OneWireMultiBus(const PinName* pins, int count, eSpeed speed);
+    ~OneWireMultiBus();
+
+    int busCount() const { return buses; }
+
+    // reset every bus, returns the mask of buses with a presence pulse
+    int reset();
+
+    // the same byte on every bus
+    void writeByte(int data);
+    void skipROM();
+
+    // one byte per bus, data[i] goes to or comes from bus i
+    void writeBytes(const BYTE* data);
+    void readBytes(BYTE* data);
+    void matchROM(BYTE (*rom)[ADDRESS_SIZE]);
+
+private:
+    PortInOut* port;
+    int buses;
+    int busBit[ONEWIRE_MAX_BUSES];    // port bit of each bus
+    int allBits;
+    unsigned int slotCycles[10];      // timings A..J in core clock cycles
+    eSpeed busSpeed;
+
+    int fromPort(int portBits);
+
+    // one time slot on every bus at once, in port bits
+    void writeBits(int ones);
+    int readBits();
+};
+
+#endif
@@ -22,10 +22,9 @@
 
 #include "OneWireThermometer.h"
 #include "OneWireDefs.h"
+#include "OneWireTiming.h"
 #include "DebugTrace.h"
 
-DebugTrace pc(OFF, TO_SERIAL);
-
 // constructor specifies standard speed for the 1-Wire comms
 OneWireThermometer::OneWireThermometer(bool crcOn, bool useAddr, bool parasitic, PinName pin, int device_id) :
     useCRC(crcOn), useAddress(useAddr), useParasiticPower(parasitic), 
@@ -34,6 +33,15 @@ OneWireThermometer::OneWireThermometer(bool crcOn, bool useAddr, bool parasitic,
     // NOTE: the power-up resolution of a DS18B20 is 12 bits. The DS18S20's resolution is always
     // 9 bits + enhancement, but we treat the DS18S20 as fixed to 12 bits for calculating the
     // conversion time Tconv.
+    clearHealth();
+}
+
+// constructor for a bus driven by a UART, standard speed only
+OneWireThermometer::OneWireThermometer(bool crcOn, bool useAddr, bool parasitic, PinName tx, PinName rx, int device_id) :
+    useCRC(crcOn), useAddress(useAddr), useParasiticPower(parasitic), 
+    oneWire(tx, rx), deviceId(device_id), resolution(twelveBit)
+{
+    clearHealth();
 }
 
 bool OneWireThermometer::initialize()
@@ -42,28 +50,34 @@ bool OneWireThermometer::initialize()
     // - not really needed except for device validation if using skipROM()
     if (useAddress)
     {
-        pc.traceOut("\r\n");
-        pc.traceOut("New Scan\r\n");
+        TRACE_INFO("\r\n");
+        TRACE_INFO("New Scan\r\n");
 
+        // a search pass of OneWireHotPlug on the same bus goes on where it was
+        OneWireSearchState saved;
+        bool found;
+        
+        oneWire.saveSearch(&saved);
         oneWire.resetSearch();    
-        if (!oneWire.search(address))   // search for 1-wire device address
+        found = oneWire.search(address);   // search for 1-wire device address
+        oneWire.restoreSearch(&saved);
+        
+        if (!found)
         {            
-            pc.traceOut("No more addresses.\r\n");
-            wait(2);
+            TRACE_ERROR("No more addresses.\r\n");
             return false;
         }
 
-        pc.traceOut("Address = ");
+        TRACE_INFO("Address = ");
         for (int i = 0; i < ADDRESS_SIZE; i++) 
         {
-            pc.traceOut("%x ", (int)address[i]);
+            TRACE_INFO("%x ", (int)address[i]);
         }
-        pc.traceOut("\r\n");
+        TRACE_INFO("\r\n");
         
         if (OneWireCRC::crc8(address, ADDRESS_CRC_BYTE) != address[ADDRESS_CRC_BYTE])   // check address CRC is valid
         {
-            pc.traceOut("CRC is not valid!\r\n");
-            wait(2);
+            TRACE_ERROR("CRC is not valid!\r\n");
             return false;
         }
 
@@ -71,22 +85,28 @@ bool OneWireThermometer::initialize()
         {                    
             // Make sure it is a one-wire thermometer device
             if (DS18B20_ID == deviceId)
-                pc.traceOut("You need to use a DS1820 or DS18S20 for correct results.\r\n");
+                TRACE_ERROR("You need to use a DS1820 or DS18S20 for correct results.\r\n");
             else if (DS18S20_ID == deviceId)
-                pc.traceOut("You need to use a DS18B20 for correct results.\r\n");
+                TRACE_ERROR("You need to use a DS18B20 for correct results.\r\n");
             else
-              pc.traceOut("Device is not a DS18B20/DS1820/DS18S20 device.\r\n");
-            
-            wait(2);
+              TRACE_ERROR("Device is not a DS18B20/DS1820/DS18S20 device.\r\n");
             return false;   
         }
         else
         {
-            if (DS18B20_ID == deviceId) pc.traceOut("DS18B20 present and correct.\r\n");
-            if (DS18S20_ID == deviceId) pc.traceOut("DS1820/DS18S20 present and correct.\r\n");            
+            if (DS18B20_ID == deviceId) TRACE_INFO("DS18B20 present and correct.\r\n");
+            if (DS18S20_ID == deviceId) TRACE_INFO("DS1820/DS18S20 present and correct.\r\n");            
         }
     }
     
+    // a parasite powered device answers Read Power Supply by pulling the
+    // line low, it then needs the strong pull-up during conversions and
+    // EEPROM writes (with skip ROM: if any device on the bus does)
+    resetAndAddress();
+    oneWire.writeByte(READPOWERSUPPLY);
+    useParasiticPower = !oneWire.readBit();
+    TRACE_INFO("%s power\r\n", useParasiticPower ? "Parasite" : "External");
+    
     return true;
 }
 
@@ -111,57 +131,200 @@ void OneWireThermometer::resetAndAddress()
 bool OneWireThermometer::readAndValidateData(BYTE* data)
 {
     bool dataOk = true;
+    BYTE crc = 0;
     
     resetAndAddress();
     oneWire.writeByte(READSCRATCH);    // read Scratchpad
 
-    pc.traceOut("read = ");
+    TRACE_DEBUG("read = ");
     for (int i = 0; i < THERMOM_SCRATCHPAD_SIZE; i++) 
     {               
         // we need all bytes which includes CRC check byte
         data[i] = oneWire.readByte();
-        pc.traceOut("%x ", (int)data[i]);
+        crc = OneWireCRC::crc8Update(crc, data[i]);    // check as we go
+        TRACE_DEBUG("%x ", (int)data[i]);
     }
-    pc.traceOut("\r\n");
+    TRACE_DEBUG("\r\n");
 
-    // Check CRC is valid if you want to
-    if (useCRC && !(OneWireCRC::crc8(data, THERMOM_CRC_BYTE) == data[THERMOM_CRC_BYTE]))  
+    // Check CRC is valid if you want to - over the data and CRC byte it must be zero
+    if (useCRC && (crc != 0))  
     {  
         // CRC failed
-        pc.traceOut("CRC FAILED... \r\n");
+        health.crcFailures++;
+        TRACE_ERROR("CRC FAILED... \r\n");
         dataOk = false;
     }
     
     return dataOk;
 }
 
-float OneWireThermometer::readTemperature()
+// Program the TH/TL alarm registers. The scratchpad holds the EEPROM values
+// after power up, so the EEPROM is only written when the thresholds change.
+bool OneWireThermometer::setAlarms(signed char high, signed char low)
+{
+    BYTE data[THERMOM_SCRATCHPAD_SIZE];
+    
+    if (!readAndValidateData(data)) return false;
+    
+    if ((signed char)data[HIGH_ALARM_BYTE] == high && (signed char)data[LOW_ALARM_BYTE] == low)
+    {
+        return true;    // already set
+    }
+    
+    resetAndAddress();
+    oneWire.writeByte(WRITESCRATCH);
+    oneWire.writeByte(high);
+    oneWire.writeByte(low);
+    // the DS18B20 also takes the configuration register, keep the resolution
+    if (DS18B20_ID == deviceId) oneWire.writeByte(data[CONFIG_REG_BYTE]);
+    
+    // save to EEPROM so the thresholds survive a power cycle
+    resetAndAddress();
+    oneWire.writeByte(COPYSCRATCH, useParasiticPower);
+    wait_ms(COPYSCRATCH_TIME);
+    oneWire.depower();
+    
+    TRACE_INFO("Alarms set to %d/%d\r\n", (int)high, (int)low);
+    
+    return true;
+}
+
+// Broadcast a Convert to every device on the bus, wait for it to finish and
+// collect the addresses of the devices whose alarm flag is set with one
+// conditional search. Returns the number of addresses stored.
+int OneWireThermometer::findAlarms(BYTE (*alarmAddr)[ADDRESS_SIZE], int maxDevices)
+{
+    int found = 0;
+    OneWireSearchState saved;
+    
+    oneWire.reset();
+    oneWire.skipROM();
+    // other devices may be parasite powered, and at a higher resolution
+    oneWire.writeByte(CONVERT, true);
+    wait_ms(CONVERSION_TIME[twelveBit]);
+    oneWire.depower();
+    
+    // a search pass of OneWireHotPlug on the same bus goes on where it was
+    oneWire.saveSearch(&saved);
+    oneWire.resetSearch();
+    while (found < maxDevices && oneWire.alarmSearch(alarmAddr[found]))
+    {
+        found++;
+    }
+    oneWire.restoreSearch(&saved);
+    
+    return found;
+}
+
+short OneWireThermometer::readTemperatureFixed()
 {
     BYTE data[THERMOM_SCRATCHPAD_SIZE];
-    float realTemp = -999;
+    short realTemp = TEMPERATURE_INVALID;
 
+    health.reads++;
     resetAndAddress();
-    oneWire.writeByte(CONVERT);     // issue Convert command
+    oneWire.writeByte(CONVERT, useParasiticPower);     // issue Convert command
     
     if (useParasiticPower)
     {
-        // wait while converting - Tconv (according to resolution of reading)
+        // hold the strong pull-up while converting - Tconv (according to
+        // resolution of reading), the device can't answer read slots meanwhile
         wait_ms(CONVERSION_TIME[resolution]);
+        oneWire.depower();
     }
     else
     {
-        // TODO
-        // after the Convert command, the device should respond by transmitting 0
-        // while the temperature conversion is in progress and 1 when the conversion is done
-        // - as were are not checking this (TODO), we use Tconv, as we would do for
-        // parasitic power 
-        wait_ms(CONVERSION_TIME[resolution]);
+        waitForConversion();
     }
 
-    if (readAndValidateData(data))    // issue Read Scratchpad commmand and get data
+    // issue Read Scratchpad commmand and get data, the scratchpad keeps its
+    // value so a failed CRC only needs another read, not another conversion
+    bool dataOk = readAndValidateData(data);
+    for (int retry = 0; !dataOk && (retry < READ_RETRIES); retry++)
+    {
+        health.retries++;
+        dataOk = readAndValidateData(data);
+    }
+    
+    if (dataOk)
     {
         realTemp = calculateTemperature(data);
+        
+        // a real reading can be 85 deg C, so this is only counted
+        if (POWER_ON_TEMPERATURE == realTemp) health.powerOnValues++;
+    }
+    else
+    {
+        health.failures++;
     }
     
     return realTemp; 
+}
+
+// After the Convert command a device on external power transmits 0 while the
+// conversion is in progress and 1 when it is done, so poll for that rather
+// than always waiting Tconv. The time taken is kept: a device that gets much
+// slower than its datasheet, or never finishes, points at power or wiring.
+void OneWireThermometer::waitForConversion()
+{
+    unsigned int start = cycleCount();
+    unsigned int cyclesPerMs = SystemCoreClock / 1000;
+    int elapsedMs;
+    
+    while (!oneWire.readBit())
+    {
+        elapsedMs = (cycleCount() - start) / cyclesPerMs;
+        if (elapsedMs > 2 * CONVERSION_TIME[resolution])
+        {
+            health.conversionTimeouts++;
+            break;
+        }
+        wait_us(CONVERSION_POLL_US);
+    }
+    
+    elapsedMs = (cycleCount() - start) / cyclesPerMs;
+    health.conversionMs = elapsedMs;
+    if (elapsedMs > health.maxConversionMs) health.maxConversionMs = elapsedMs;
+}
+
+void OneWireThermometer::clearHealth()
+{
+    memset(&health, 0, sizeof(health));
+    health.conversionMs = -1;
+    oneWire.clearHealth();
+}
+
+// Dump the bus and device counters, e.g. to the PC serial port.
+void OneWireThermometer::printHealth(Serial& out)
+{
+    const OneWireBusHealth& bus = oneWire.busHealth();
+    
+    out.printf("1-Wire bus: resets %u, no presence %u, searches %u, collisions %u, search errors %u\r\n",
+        bus.resets, bus.presenceFailures, bus.searches, bus.searchCollisions, bus.searchErrors);
+    
+    out.printf("device ");
+    if (useAddress)
+    {
+        for (int i = ADDRESS_SIZE - 1; i >= 0; i--) out.printf("%02x", (int)address[i]);
+    }
+    else
+    {
+        out.printf("(skip ROM)");
+    }
+    out.printf(": reads %u, failed %u, CRC errors %u, retries %u, 85C values %u\r\n",
+        health.reads, health.failures, health.crcFailures, health.retries, health.powerOnValues);
+    
+    out.printf("conversion: last %d ms, max %d ms, timeouts %u\r\n",
+        health.conversionMs, health.maxConversionMs, health.conversionTimeouts);
+}
+
+// Convenience wrapper for code that wants deg C as a float. Keep it off the
+// sampling path: on the M3 every float operation is a library call.
+float OneWireThermometer::readTemperature()
+{
+    short realTemp = readTemperatureFixed();
+    
+    if (TEMPERATURE_INVALID == realTemp) return -999;
+    
+    return (float)realTemp / 16;
 }
\ No newline at end of file
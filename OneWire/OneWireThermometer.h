@@ -29,17 +29,46 @@
 
 typedef unsigned char BYTE;    // something a byte wide
 
+// per device health counters, see printHealth()
+struct OneWireDeviceHealth
+{
+    unsigned int reads;
+    unsigned int failures;            // reads that returned TEMPERATURE_INVALID
+    unsigned int crcFailures;
+    unsigned int retries;
+    unsigned int powerOnValues;       // 85 deg C, the device may have browned out
+    unsigned int conversionTimeouts;
+    int conversionMs;                 // last measured, -1 until measured
+    int maxConversionMs;
+};
+
 class OneWireThermometer
 {
 public:
     OneWireThermometer(bool crcOn, bool useAddr, bool parasitic, PinName pin, int device_id);
+    OneWireThermometer(bool crcOn, bool useAddr, bool parasitic, PinName tx, PinName rx, int device_id);
     
-    bool initialize();
-    float readTemperature();
+    bool initialize();               // false right away when no device is found, the caller retries
+    short readTemperatureFixed();    // 1/16 deg C, TEMPERATURE_INVALID on failure
+    float readTemperature();         // deg C, -999 on failure
     virtual void setResolution(eResolution resln) = 0; 
+    
+    // alarm thresholds in whole deg C, kept in the device EEPROM
+    bool setAlarms(signed char high, signed char low);
+    // start a conversion on every device on the bus, then list those in alarm
+    // (like initialize() it keeps the search pass of a OneWireHotPlug on the bus)
+    int findAlarms(BYTE (*alarmAddr)[ADDRESS_SIZE], int maxDevices);
+    
+    const OneWireDeviceHealth& deviceHealth() const { return health; }
+    const OneWireBusHealth& busHealth() const { return oneWire.busHealth(); }
+    void clearHealth();
+    void printHealth(Serial& out);
+    
+    // the bus the device is on, e.g. for an OneWireHotPlug watching it
+    OneWireCRC& bus() { return oneWire; }
 
 protected:
-    const bool useParasiticPower;
+    bool useParasiticPower;    // found out with Read Power Supply by initialize()
     const bool useCRC;
     const bool useAddress;
     const int deviceId;
@@ -48,10 +77,12 @@ protected:
     BYTE address[8];
     
     OneWireCRC oneWire;
+    OneWireDeviceHealth health;
     
     void resetAndAddress();
     bool readAndValidateData(BYTE* data);
-    virtual float calculateTemperature(BYTE* data) = 0;    // device specific
+    void waitForConversion();
+    virtual short calculateTemperature(BYTE* data) = 0;    // device specific, 1/16 deg C
 };
 
 #endif
\ No newline at end of file
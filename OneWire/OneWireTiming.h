@@ -0,0 +1,67 @@
+/*
+* OneWireTiming. Cycle accurate delays for the OneWireCRC library, using
+* the Cortex-M3 DWT cycle counter.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNATCH59_ONEWIRETIMING_H
+#define SNATCH59_ONEWIRETIMING_H
+
+#include <mbed.h>
+
+// recommended timings A..J from Maxim Application Note 126, in nano seconds
+const unsigned int standardT[] = {6000, 64000, 60000, 10000, 9000, 55000, 0, 480000, 70000, 410000};
+const unsigned int overdriveT[] = {1000, 7500, 7500, 2500, 1000, 7000, 2500, 70000, 8500, 40000};
+
+// start the free running cycle counter, safe to call more than once
+inline void cycleCounterInit()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline unsigned int cycleCount()
+{
+    return DWT->CYCCNT;
+}
+
+// busy wait until 'cycles' have passed since 'start' (wraps safely)
+inline void waitCycles(unsigned int start, unsigned int cycles)
+{
+    while ((cycleCount() - start) < cycles);
+}
+
+// convert nano seconds to core clock cycles, good for delays up to ~40 ms
+inline unsigned int nsToCycles(unsigned int ns)
+{
+    return (SystemCoreClock / 1000000) * ns / 1000;
+}
+
+// mask interrupts around a timing critical edge, restoring the previous state
+inline unsigned int enterCritical()
+{
+    unsigned int primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+inline void exitCritical(unsigned int primask)
+{
+    __set_PRIMASK(primask);
+}
+
+#endif
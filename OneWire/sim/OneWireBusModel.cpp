@@ -0,0 +1,719 @@
+/*
+* OneWireBusModel. A host side model of a 1-Wire bus with DS18B20/DS18S20
+* devices on it, driven through the sim DigitalInOut/Serial on the bus pin.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef ONEWIRE_HOST_SIM
+
+#include "OneWireBusModel.h"
+
+// device side timing in ns, {standard, overdrive}
+const unsigned long long RESET_DETECT[] = {240000, 24000};    // devices see a reset well before 480 us
+const unsigned long long RESET_MIN[] = {480000, 48000};       // what the master must hold
+const unsigned long long SLOT_MAX[] = {120000, 16000};
+const unsigned long long WRITE_ONE_MAX[] = {15000, 2000};     // shorter low pulse reads as a '1'
+const unsigned long long PRESENCE_WAIT[] = {30000, 3000};
+const unsigned long long PRESENCE_LOW[] = {120000, 10000};
+const unsigned long long ZERO_HOLD[] = {30000, 3000};         // how long a '0' is held in a read slot
+
+const unsigned long long COUNTER_READ_NS = 40;    // cost of one DWT->CYCCNT read
+const unsigned long long ROUNDING_NS = 1000;      // cycle count rounding allowed on a reset
+
+uint32_t SystemCoreClock = 96000000;
+DWT_Type simDWT;
+CoreDebug_Type simCoreDebug;
+
+static unsigned long long simTime = 0;
+static uint32_t simPrimask = 0;
+
+OneWireBusModel* OneWireBusModel::buses[SIM_MAX_BUSES];
+
+//------------------------------ virtual clock ------------------------------
+
+unsigned long long simNowNs()
+{
+    return simTime;
+}
+
+void simAdvanceNs(unsigned long long ns)
+{
+    simTime += ns;
+}
+
+void wait(float s)
+{
+    simAdvanceNs((unsigned long long)(s * 1e9f));
+}
+
+void wait_ms(int ms)
+{
+    simAdvanceNs((unsigned long long)ms * 1000000);
+}
+
+void wait_us(int us)
+{
+    simAdvanceNs((unsigned long long)us * 1000);
+}
+
+void error(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    exit(1);
+}
+
+SimCycleCounter::operator uint32_t() const
+{
+    simAdvanceNs(COUNTER_READ_NS);
+    return (uint32_t)(simTime * (SystemCoreClock / 1000000) / 1000);
+}
+
+uint32_t __get_PRIMASK()
+{
+    return simPrimask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+    simPrimask = primask;
+}
+
+void __disable_irq()
+{
+    simPrimask = 1;
+}
+
+void __enable_irq()
+{
+    simPrimask = 0;
+}
+
+void pin_mode(PinName pin, PinMode mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+//------------------------------ pins ---------------------------------------
+
+DigitalInOut::DigitalInOut(PinName pin) : pin(pin), isOutput(false), level(1)
+{
+}
+
+void DigitalInOut::output()
+{
+    isOutput = true;
+    update();
+}
+
+void DigitalInOut::input()
+{
+    isOutput = false;
+    update();
+}
+
+void DigitalInOut::mode(PinMode pull)
+{
+    (void)pull;
+}
+
+void DigitalInOut::write(int value)
+{
+    level = value & 0x01;
+    update();
+}
+
+int DigitalInOut::read()
+{
+    OneWireBusModel* bus = OneWireBusModel::find(pin);
+    if (bus != NULL) return bus->sample();
+    return isOutput ? level : 1;
+}
+
+void DigitalInOut::update()
+{
+    // driving high is treated as letting go, the bus is open drain
+    OneWireBusModel* bus = OneWireBusModel::find(pin);
+    if (bus != NULL) bus->drive(isOutput && (0 == level));
+}
+
+PortInOut::PortInOut(PortName port, int mask) : port(port), mask(mask), isOutput(false), level(0)
+{
+}
+
+void PortInOut::write(int value)
+{
+    level = value;
+    update();
+}
+
+int PortInOut::read()
+{
+    int value = 0;
+    for (int bit = 0; bit < 32; bit++)
+    {
+        if (!(mask & (1 << bit))) continue;
+
+        OneWireBusModel* bus = OneWireBusModel::find((PinName)((port << PORT_SHIFT) + bit));
+        int high = (bus != NULL) ? bus->sample() : (isOutput ? ((level >> bit) & 0x01) : 1);
+        if (high) value |= 1 << bit;
+    }
+    return value;
+}
+
+void PortInOut::output()
+{
+    isOutput = true;
+    update();
+}
+
+void PortInOut::input()
+{
+    isOutput = false;
+    update();
+}
+
+void PortInOut::mode(PinMode pull)
+{
+    (void)pull;
+}
+
+void PortInOut::update()
+{
+    for (int bit = 0; bit < 32; bit++)
+    {
+        if (!(mask & (1 << bit))) continue;
+
+        OneWireBusModel* bus = OneWireBusModel::find((PinName)((port << PORT_SHIFT) + bit));
+        if (bus != NULL) bus->drive(isOutput && !((level >> bit) & 0x01));
+    }
+}
+
+Serial::Serial(PinName tx, PinName rx, const char* name) :
+    txPin(tx), bitNs(1000000000 / 9600), echoHead(0), echoCount(0)
+{
+    (void)rx;
+    (void)name;
+}
+
+void Serial::baud(int baudrate)
+{
+    bitNs = 1000000000 / baudrate;
+}
+
+void Serial::format(int bits, Parity parity, int stop_bits)
+{
+    (void)bits;
+    (void)parity;
+    (void)stop_bits;
+}
+
+int Serial::putc(int c)
+{
+    OneWireBusModel* bus = OneWireBusModel::find(txPin);
+    if (NULL == bus) return putchar(c);
+
+    // start bit, 8 data bits LSB first, stop bit - rx samples mid bit
+    int received = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        int level = (0 == i) ? 0 : (9 == i) ? 1 : ((c >> (i - 1)) & 0x01);
+        bus->drive(0 == level);
+        simAdvanceNs(bitNs / 2);
+        if ((i >= 1) && (i <= 8) && bus->sample()) received |= 0x01 << (i - 1);
+        simAdvanceNs(bitNs - bitNs / 2);
+    }
+
+    if (echoCount < (int)sizeof(echo))
+    {
+        echo[(echoHead + echoCount) % sizeof(echo)] = received;
+        echoCount++;
+    }
+    return c;
+}
+
+int Serial::getc()
+{
+    if (0 == echoCount) return -1;    // nothing will ever arrive
+
+    int c = echo[echoHead];
+    echoHead = (echoHead + 1) % sizeof(echo);
+    echoCount--;
+    return c;
+}
+
+int Serial::readable()
+{
+    return echoCount > 0;
+}
+
+int Serial::printf(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    int size = vprintf(format, ap);
+    va_end(ap);
+    return size;
+}
+
+//------------------------------ device -------------------------------------
+
+OneWireSimDevice::OneWireSimDevice(BYTE family, unsigned long long serial) :
+    temperature(25 * 16), parasitic(false), overdrive(false), conversionMs(0), crcFaults(0)
+{
+    romCode[0] = family;
+    for (int i = 1; i < ADDRESS_CRC_BYTE; i++)
+    {
+        romCode[i] = serial & 0xFF;
+        serial >>= 8;
+    }
+    romCode[ADDRESS_CRC_BYTE] = OneWireCRC::crc8(romCode, ADDRESS_CRC_BYTE);
+
+    // factory EEPROM: TH 75, TL 70, 12 bit
+    eeprom[0] = 0x4B;
+    eeprom[1] = 0x46;
+    eeprom[2] = 0x7F;
+
+    powerOnReset();
+}
+
+void OneWireSimDevice::setTemperature(short temp)
+{
+    temperature = temp;
+}
+
+void OneWireSimDevice::setParasitic(bool parasite)
+{
+    parasitic = parasite;
+}
+
+void OneWireSimDevice::setConversionTime(int ms)
+{
+    conversionMs = ms;
+}
+
+void OneWireSimDevice::corruptReads(int count)
+{
+    crcFaults = count;
+}
+
+void OneWireSimDevice::powerOnReset()
+{
+    scratch[HIGH_ALARM_BYTE] = eeprom[0];
+    scratch[LOW_ALARM_BYTE] = eeprom[1];
+    scratch[CONFIG_REG_BYTE] = (DS18B20_ID == romCode[0]) ? eeprom[2] : 0xFF;
+    scratch[CONFIG_READ_END] = 0xFF;
+    scratch[COUNT_REMAIN_BYTE] = 0x0C;
+    scratch[COUNT_PER_DEG_BYTE] = 0x10;
+    writeRegister(85 * 16);
+
+    state = IDLE;
+    overdrive = false;
+    convertPending = false;
+    sendBit = -1;
+    holdFrom = holdUntil = 0;
+}
+
+void OneWireSimDevice::busReset(unsigned long long now, bool standard)
+{
+    if (standard) overdrive = false;
+
+    state = ROM_COMMAND;
+    expect(8);
+
+    // presence pulse
+    holdFrom = now + PRESENCE_WAIT[overdrive];
+    holdUntil = holdFrom + PRESENCE_LOW[overdrive];
+}
+
+void OneWireSimDevice::fallingEdge(unsigned long long now)
+{
+    latchConversion(now);
+
+    sendBit = nextBit(now);
+    if (0 == sendBit)
+    {
+        holdFrom = now;
+        holdUntil = now + ZERO_HOLD[overdrive];
+    }
+}
+
+void OneWireSimDevice::risingEdge(unsigned long long now, unsigned long long lowNs)
+{
+    latchConversion(now);
+
+    if (lowNs >= RESET_DETECT[overdrive])
+    {
+        sendBit = -1;
+        busReset(now, lowNs >= RESET_DETECT[0]);
+        return;
+    }
+
+    if (sendBit >= 0)
+    {
+        // a read slot, move on to the next bit to send
+        sendBit = -1;
+        if (TRANSMIT == state)
+        {
+            if (++bitPos == bitCount)
+            {
+                state = afterTransmit;
+                expect(8);
+            }
+        }
+        else if (SEARCH == state)
+        {
+            searchPhase++;
+        }
+        return;
+    }
+
+    receive((lowNs < WRITE_ONE_MAX[overdrive]) ? 1 : 0, now);
+}
+
+bool OneWireSimDevice::holdsLow(unsigned long long now) const
+{
+    return (now >= holdFrom) && (now < holdUntil);
+}
+
+void OneWireSimDevice::receive(int bit, unsigned long long now)
+{
+    if (SEARCH == state)
+    {
+        if (searchPhase < 2) return;    // master wrote where it should have read
+
+        // the master's chosen direction, drop out if it is not our bit
+        int romBit = (romCode[bitPos / 8] >> (bitPos % 8)) & 0x01;
+        if (bit != romBit)
+        {
+            state = IDLE;
+            return;
+        }
+        searchPhase = 0;
+        if (++bitPos == ADDRESS_SIZE * 8)
+        {
+            state = FUNCTION;
+            expect(8);
+        }
+        return;
+    }
+
+    if ((ROM_COMMAND != state) && (MATCH != state) && (FUNCTION != state) && (RECEIVE != state)) return;
+
+    data[bitPos / 8] |= bit << (bitPos % 8);
+    if (++bitPos < bitCount) return;
+
+    switch (state)
+    {
+        case ROM_COMMAND:
+            romCommand(data[0]);
+            break;
+        case MATCH:
+            if (0 == memcmp(data, romCode, ADDRESS_SIZE))
+            {
+                state = FUNCTION;
+                expect(8);
+            }
+            else state = IDLE;
+            break;
+        case FUNCTION:
+            functionCommand(data[0], now);
+            break;
+        default:    // RECEIVE, the Write Scratchpad bytes
+            memcpy(scratch + HIGH_ALARM_BYTE, data, bitCount / 8);
+            updateCrc();
+            state = IDLE;
+            break;
+    }
+}
+
+void OneWireSimDevice::romCommand(BYTE command)
+{
+    switch (command)
+    {
+        case READ_ROM:
+            transmit(romCode, ADDRESS_SIZE * 8, FUNCTION);
+            break;
+        case MATCH_ROM:
+            state = MATCH;
+            expect(ADDRESS_SIZE * 8);
+            break;
+        case OVERDRIVE_SKIP:
+            overdrive = true;
+            // fall through
+        case SKIP_ROM:
+            state = FUNCTION;
+            expect(8);
+            break;
+        case ALARM_SEARCH:
+        case SEARCH_ROM:
+            if ((ALARM_SEARCH == command) && !alarming())
+            {
+                state = IDLE;
+                break;
+            }
+            state = SEARCH;
+            bitPos = 0;
+            searchPhase = 0;
+            break;
+        default:
+            state = IDLE;
+            break;
+    }
+}
+
+void OneWireSimDevice::functionCommand(BYTE command, unsigned long long now)
+{
+    int ms = conversionMs;
+    BYTE power = parasitic ? 0x00 : 0x01;    // parasite powered devices pull low
+
+    switch (command)
+    {
+        case CONVERT:
+            if (0 == ms) ms = (DS18B20_ID == romCode[0]) ? CONVERSION_TIME[(scratch[CONFIG_REG_BYTE] >> 5) & 0x03] : 750;
+            convertPending = true;
+            convertDone = now + (unsigned long long)ms * 1000000;
+            convertValue = temperature;
+            state = CONVERTING;
+            break;
+        case READSCRATCH:
+            transmit(scratch, THERMOM_SCRATCHPAD_SIZE * 8, IDLE);
+            if (crcFaults > 0)
+            {
+                crcFaults--;
+                data[TEMPERATURE_LSB] ^= 0x01;
+            }
+            break;
+        case WRITESCRATCH:
+            state = RECEIVE;
+            expect((DS18B20_ID == romCode[0]) ? 24 : 16);
+            break;
+        case COPYSCRATCH:
+            memcpy(eeprom, scratch + HIGH_ALARM_BYTE, ALARM_CONFIG_SIZE);
+            state = IDLE;
+            break;
+        case RECALLE2:
+            memcpy(scratch + HIGH_ALARM_BYTE, eeprom, (DS18B20_ID == romCode[0]) ? 3 : 2);
+            updateCrc();
+            state = IDLE;
+            break;
+        case READPOWERSUPPLY:
+            transmit(&power, 1, IDLE);
+            break;
+        default:
+            state = IDLE;
+            break;
+    }
+}
+
+void OneWireSimDevice::transmit(const BYTE* bytes, int bits, eState next)
+{
+    memcpy(data, bytes, (bits + 7) / 8);
+    bitCount = bits;
+    bitPos = 0;
+    afterTransmit = next;
+    state = TRANSMIT;
+}
+
+void OneWireSimDevice::expect(int bits)
+{
+    memset(data, 0, sizeof(data));
+    bitCount = bits;
+    bitPos = 0;
+}
+
+int OneWireSimDevice::nextBit(unsigned long long now)
+{
+    switch (state)
+    {
+        case TRANSMIT:
+            return (data[bitPos / 8] >> (bitPos % 8)) & 0x01;
+        case CONVERTING:
+            return (convertPending && (now < convertDone)) ? 0 : 1;
+        case SEARCH:
+            if (searchPhase < 2)
+            {
+                int romBit = (romCode[bitPos / 8] >> (bitPos % 8)) & 0x01;
+                return (0 == searchPhase) ? romBit : !romBit;
+            }
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+void OneWireSimDevice::latchConversion(unsigned long long now)
+{
+    if (convertPending && (now >= convertDone))
+    {
+        writeRegister(convertValue);
+        convertPending = false;
+    }
+}
+
+void OneWireSimDevice::writeRegister(short temp)
+{
+    if (temp > 125 * 16) temp = 125 * 16;
+    if (temp < -55 * 16) temp = -55 * 16;
+
+    short reg;
+    if (DS18B20_ID == romCode[0])
+    {
+        // low bits are undefined below 12 bit, leave them clear
+        int unused = 3 - ((scratch[CONFIG_REG_BYTE] >> 5) & 0x03);
+        reg = temp & ~((1 << unused) - 1);
+    }
+    else
+    {
+        // half degree register plus the count remain that refines it
+        int whole = (temp + 4) >= 0 ? (temp + 4) / 16 : -((-(temp + 4) + 15) / 16);
+        reg = (temp + 4) >= 0 ? (temp + 4) / 8 : -((-(temp + 4) + 7) / 8);
+        scratch[COUNT_REMAIN_BYTE] = whole * 16 + 12 - temp;
+    }
+
+    scratch[TEMPERATURE_LSB] = reg & 0xFF;
+    scratch[TEMPERATURE_MSB] = (reg >> 8) & 0xFF;
+    updateCrc();
+}
+
+void OneWireSimDevice::updateCrc()
+{
+    scratch[THERMOM_CRC_BYTE] = OneWireCRC::crc8(scratch, THERMOM_CRC_BYTE);
+}
+
+bool OneWireSimDevice::alarming() const
+{
+    short reg = scratch[TEMPERATURE_LSB] | (scratch[TEMPERATURE_MSB] << 8);
+    int whole = (DS18B20_ID == romCode[0]) ? (reg >> 4) : (reg >> 1);
+    return (whole >= (signed char)scratch[HIGH_ALARM_BYTE]) || (whole <= (signed char)scratch[LOW_ALARM_BYTE]);
+}
+
+//------------------------------ bus ----------------------------------------
+
+OneWireBusModel::OneWireBusModel(PinName pin) : busPin(pin), deviceCount(0), masterLow(false), lowSince(0)
+{
+    clearStats();
+    for (int i = 0; i < SIM_MAX_BUSES; i++)
+    {
+        if (NULL == buses[i])
+        {
+            buses[i] = this;
+            break;
+        }
+    }
+}
+
+OneWireBusModel::~OneWireBusModel()
+{
+    for (int i = 0; i < SIM_MAX_BUSES; i++)
+    {
+        if (this == buses[i]) buses[i] = NULL;
+    }
+}
+
+bool OneWireBusModel::attach(OneWireSimDevice* device)
+{
+    if (deviceCount >= SIM_MAX_DEVICES) return false;
+
+    device->powerOnReset();
+    devices[deviceCount++] = device;
+    return true;
+}
+
+void OneWireBusModel::detach(OneWireSimDevice* device)
+{
+    for (int i = 0; i < deviceCount; i++)
+    {
+        if (device == devices[i])
+        {
+            devices[i] = devices[--deviceCount];
+            return;
+        }
+    }
+}
+
+void OneWireBusModel::clearStats()
+{
+    memset(&busStats, 0, sizeof(busStats));
+}
+
+OneWireBusModel* OneWireBusModel::find(PinName pin)
+{
+    for (int i = 0; i < SIM_MAX_BUSES; i++)
+    {
+        if ((buses[i] != NULL) && (pin == buses[i]->busPin)) return buses[i];
+    }
+    return NULL;
+}
+
+void OneWireBusModel::drive(bool low)
+{
+    unsigned long long now = simNowNs();
+
+    if (low && !masterLow)
+    {
+        // devices only see an edge if none of them is holding the line already
+        bool lineHigh = (sample() != 0);
+        masterLow = true;
+        lowSince = now;
+        if (lineHigh)
+        {
+            for (int i = 0; i < deviceCount; i++) devices[i]->fallingEdge(now);
+        }
+    }
+    else if (!low && masterLow)
+    {
+        masterLow = false;
+        unsigned long long lowNs = now - lowSince;
+        busStats.lowNs += lowNs;
+
+        bool overdrive = false;
+        for (int i = 0; i < deviceCount; i++) overdrive |= devices[i]->inOverdrive();
+
+        if (lowNs >= RESET_DETECT[overdrive])
+        {
+            busStats.resets++;
+            if (deviceCount > 0) busStats.presencePulses++;
+            if (lowNs + ROUNDING_NS < RESET_MIN[overdrive]) busStats.badPulses++;
+        }
+        else
+        {
+            busStats.slots++;
+            if (lowNs > SLOT_MAX[overdrive]) busStats.badPulses++;
+        }
+
+        for (int i = 0; i < deviceCount; i++) devices[i]->risingEdge(now, lowNs);
+    }
+}
+
+int OneWireBusModel::sample()
+{
+    if (masterLow) return 0;
+
+    unsigned long long now = simNowNs();
+    for (int i = 0; i < deviceCount; i++)
+    {
+        if (devices[i]->holdsLow(now)) return 0;
+    }
+    return 1;
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+* OneWireBusModel. A host side model of a 1-Wire bus with DS18B20/DS18S20
+* devices on it, driven through the sim DigitalInOut/Serial on the bus pin.
+*
+* Devices follow the line edge by edge: a long low pulse is a reset, short
+* ones are time slots, and a device sending a '0' holds the line low for a
+* while after the master's falling edge. So the real OneWireCRC timing code
+* runs unchanged and a late sample really does read the wrong bit.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNATCH59_ONEWIREBUSMODEL_H
+#define SNATCH59_ONEWIREBUSMODEL_H
+
+#include <mbed.h>
+#include "OneWireCRC.h"
+#include "OneWireDefs.h"
+
+#define SIM_MAX_DEVICES   16    // per bus
+#define SIM_MAX_BUSES     4
+
+class OneWireSimDevice
+{
+public:
+    // family is DS18B20_ID or DS18S20_ID, the ROM CRC is filled in
+    OneWireSimDevice(BYTE family, unsigned long long serial);
+
+    const BYTE* rom() const { return romCode; }
+
+    void setTemperature(short temp);         // 1/16 deg C, used by the next Convert
+    void setParasitic(bool parasitic);       // answer Read Power Supply with 0
+    void setConversionTime(int ms);          // 0 = datasheet maximum for the resolution
+    void corruptReads(int count);            // the next count scratchpad reads fail CRC
+    void powerOnReset();                     // scratchpad back to 85 deg C, EEPROM kept
+
+    // bus side, called by OneWireBusModel
+    void busReset(unsigned long long now, bool standard);
+    void fallingEdge(unsigned long long now);
+    void risingEdge(unsigned long long now, unsigned long long lowNs);
+    bool holdsLow(unsigned long long now) const;
+    bool inOverdrive() const { return overdrive; }
+
+private:
+    enum eState {IDLE, ROM_COMMAND, MATCH, SEARCH, FUNCTION, RECEIVE, TRANSMIT, CONVERTING};
+
+    BYTE romCode[ADDRESS_SIZE];
+    BYTE scratch[THERMOM_SCRATCHPAD_SIZE];
+    BYTE eeprom[ALARM_CONFIG_SIZE];          // TH, TL, config
+
+    short temperature;
+    bool parasitic;
+    bool overdrive;
+    int conversionMs;
+    int crcFaults;
+
+    eState state;
+    eState afterTransmit;
+    bool convertPending;
+    unsigned long long convertDone;
+    short convertValue;
+
+    BYTE data[THERMOM_SCRATCHPAD_SIZE];      // bytes being received or sent
+    int bitCount;                            // bits expected/available in data
+    int bitPos;
+    int searchPhase;                         // bit, complement, direction
+    int sendBit;                             // bit sent in this slot, -1 if none
+
+    unsigned long long holdFrom;
+    unsigned long long holdUntil;
+
+    void receive(int bit, unsigned long long now);
+    void romCommand(BYTE command);
+    void functionCommand(BYTE command, unsigned long long now);
+    void transmit(const BYTE* bytes, int bits, eState next);
+    void expect(int bits);
+    int nextBit(unsigned long long now);
+    void latchConversion(unsigned long long now);
+    void writeRegister(short temp);
+    void updateCrc();
+    bool alarming() const;
+};
+
+// bus activity counters, clearStats() to start a measurement
+struct OneWireBusStats
+{
+    int resets;
+    int presencePulses;
+    int slots;
+    int badPulses;                 // resets or slots outside the master's timing
+    unsigned long long lowNs;      // total time the master held the line low
+};
+
+class OneWireBusModel
+{
+public:
+    OneWireBusModel(PinName pin);
+    ~OneWireBusModel();
+
+    // hot-plug, a device joins idle and waits for the next reset
+    bool attach(OneWireSimDevice* device);
+    void detach(OneWireSimDevice* device);
+
+    const OneWireBusStats& stats() const { return busStats; }
+    void clearStats();
+
+    // master side, called by the sim DigitalInOut and Serial
+    static OneWireBusModel* find(PinName pin);
+    void drive(bool low);
+    int sample();
+
+private:
+    PinName busPin;
+    OneWireSimDevice* devices[SIM_MAX_DEVICES];
+    int deviceCount;
+    bool masterLow;
+    unsigned long long lowSince;
+    OneWireBusStats busStats;
+
+    static OneWireBusModel* buses[SIM_MAX_BUSES];
+};
+
+#endif
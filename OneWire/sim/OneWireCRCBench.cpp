@@ -0,0 +1,135 @@
+/*
+* OneWireCRCBench. Host check of the OneWireCRC CRCs against the bit by bit
+* method of Maxim AN27, and a rough timing of each. Build it once for each
+* CRC8 method:
+*
+*   g++ -O2 -DONEWIRE_HOST_SIM -DONEWIRE_CRC_BENCH -DONEWIRE_CRC8_TABLE=1 -IOneWire/sim -IOneWire \
+*       OneWire/OneWireCRC.cpp OneWire/sim/OneWireBusModel.cpp OneWire/sim/OneWireCRCBench.cpp
+*   (and again with -DONEWIRE_CRC8_TABLE=0 for the nibble tables)
+*
+* Every buffer must give the same CRC as the bitwise method, whole and byte
+* by byte through crc8Update()/crc16Update(), and the CRC over the data plus
+* its CRC byte(s) must be zero. The times are host times, they show how the
+* methods rank, not what they cost on the Cortex-M3.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(ONEWIRE_HOST_SIM) && defined(ONEWIRE_CRC_BENCH)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "OneWireCRC.h"
+
+#define BENCH_BUFFERS     10000     // random buffers checked
+#define BENCH_MAX_LEN     64
+#define BENCH_ROUNDS      20000     // timed passes over a 9 byte scratchpad
+
+// AN27 bit by bit, x^8 + x^5 + x^4 + 1 reflected
+static BYTE bitCrc8(BYTE* data, int len)
+{
+    BYTE crc = 0;
+
+    for (int i = 0; i < len; i++)
+    {
+        BYTE inbyte = data[i];
+        for (int j = 0; j < 8; j++)
+        {
+            BYTE mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+// x^16 + x^15 + x^2 + 1 reflected
+static unsigned short bitCrc16(BYTE* data, int len)
+{
+    unsigned short crc = 0;
+
+    for (int i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static double nsPerByte(clock_t start, int bytes)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / bytes;
+}
+
+int main()
+{
+    BYTE data[BENCH_MAX_LEN + 2];
+    int failures = 0;
+    volatile unsigned int sink = 0;
+    clock_t start;
+
+    srand(59);
+    for (int n = 0; n < BENCH_BUFFERS; n++)
+    {
+        int len = 1 + rand() % BENCH_MAX_LEN;
+        for (int i = 0; i < len; i++) data[i] = rand() & 0xFF;
+
+        BYTE crc8 = OneWireCRC::crc8(data, len);
+        unsigned short crc16 = OneWireCRC::crc16(data, len);
+        BYTE running8 = 0;
+        unsigned short running16 = 0;
+        for (int i = 0; i < len; i++)
+        {
+            running8 = OneWireCRC::crc8Update(running8, data[i]);
+            running16 = OneWireCRC::crc16Update(running16, data[i]);
+        }
+        if ((crc8 != bitCrc8(data, len)) || (running8 != crc8)) failures++;
+        if ((crc16 != bitCrc16(data, len)) || (running16 != crc16)) failures++;
+
+        // the residue check used by readAndValidateData() and search()
+        data[len] = crc8;
+        if (OneWireCRC::crc8(data, len + 1) != 0) failures++;
+        data[len] = crc16 & 0xFF;
+        data[len + 1] = crc16 >> 8;
+        if (OneWireCRC::crc16(data, len + 2) != 0) failures++;
+    }
+    printf("CRC8 method: %s\n", ONEWIRE_CRC8_TABLE ? "256 byte table" : "2 x 16 byte nibble tables");
+    printf("%d random buffers, %d mismatches\n", BENCH_BUFFERS, failures);
+
+    for (int i = 0; i < 9; i++) data[i] = rand() & 0xFF;
+
+    start = clock();
+    for (int n = 0; n < BENCH_ROUNDS; n++) { data[0] = n; sink += OneWireCRC::crc8(data, 9); }
+    printf("crc8   OneWireCRC %6.2f ns/byte\n", nsPerByte(start, BENCH_ROUNDS * 9));
+    start = clock();
+    for (int n = 0; n < BENCH_ROUNDS; n++) { data[0] = n; sink += bitCrc8(data, 9); }
+    printf("crc8   bitwise    %6.2f ns/byte\n", nsPerByte(start, BENCH_ROUNDS * 9));
+    start = clock();
+    for (int n = 0; n < BENCH_ROUNDS; n++) { data[0] = n; sink += OneWireCRC::crc16(data, 9); }
+    printf("crc16  OneWireCRC %6.2f ns/byte\n", nsPerByte(start, BENCH_ROUNDS * 9));
+    start = clock();
+    for (int n = 0; n < BENCH_ROUNDS; n++) { data[0] = n; sink += bitCrc16(data, 9); }
+    printf("crc16  bitwise    %6.2f ns/byte\n", nsPerByte(start, BENCH_ROUNDS * 9));
+
+    return failures ? 1 : 0;
+}
+
+#endif
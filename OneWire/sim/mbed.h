@@ -0,0 +1,205 @@
+/*
+* Host stand-in for the small part of mbed used by the OneWire library, so
+* the library builds on a PC and talks to OneWireBusModel instead of p25.
+* Only put this directory on the include path of host builds:
+*
+*   g++ -DONEWIRE_HOST_SIM -IOneWire/sim -IOneWire <OneWire and OneWire/sim sources> ...
+*
+* Time is virtual. wait()/wait_ms()/wait_us() move the clock on, and so does
+* every read of the cycle counter, so the busy waits in OneWireTiming.h end.
+*
+* This file is part of OneWireCRC.
+*
+* OneWireCRC is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* OneWireCRC is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with OneWireCRC.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNATCH59_SIM_MBED_H
+#define SNATCH59_SIM_MBED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// same port/bit layout as the LPC1768, so port bits map to the DIP pins
+#define PORT_SHIFT  5
+
+typedef enum
+{
+    P0_0 = 0, P0_1, P0_2, P0_3, P0_4, P0_5, P0_6, P0_7, P0_8, P0_9, P0_10,
+    P0_11, P0_12, P0_13, P0_14, P0_15, P0_16, P0_17, P0_18, P0_19, P0_20,
+    P0_21, P0_22, P0_23, P0_24, P0_25, P0_26, P0_27, P0_28, P0_29, P0_30,
+    P0_31,
+    P1_0, P1_1, P1_2, P1_3, P1_4, P1_5, P1_6, P1_7, P1_8, P1_9, P1_10,
+    P1_11, P1_12, P1_13, P1_14, P1_15, P1_16, P1_17, P1_18, P1_19, P1_20,
+    P1_21, P1_22, P1_23, P1_24, P1_25, P1_26, P1_27, P1_28, P1_29, P1_30,
+    P1_31,
+    P2_0, P2_1, P2_2, P2_3, P2_4, P2_5, P2_6, P2_7, P2_8, P2_9, P2_10,
+    P2_11, P2_12, P2_13, P2_14, P2_15, P2_16, P2_17, P2_18, P2_19, P2_20,
+    P2_21, P2_22, P2_23, P2_24, P2_25, P2_26, P2_27, P2_28, P2_29, P2_30,
+    P2_31,
+    P3_0, P3_1, P3_2, P3_3, P3_4, P3_5, P3_6, P3_7, P3_8, P3_9, P3_10,
+    P3_11, P3_12, P3_13, P3_14, P3_15, P3_16, P3_17, P3_18, P3_19, P3_20,
+    P3_21, P3_22, P3_23, P3_24, P3_25, P3_26, P3_27, P3_28, P3_29, P3_30,
+    P3_31,
+    P4_0, P4_1, P4_2, P4_3, P4_4, P4_5, P4_6, P4_7, P4_8, P4_9, P4_10,
+    P4_11, P4_12, P4_13, P4_14, P4_15, P4_16, P4_17, P4_18, P4_19, P4_20,
+    P4_21, P4_22, P4_23, P4_24, P4_25, P4_26, P4_27, P4_28, P4_29, P4_30,
+    P4_31,
+
+    p5 = P0_9, p6 = P0_8, p7 = P0_7, p8 = P0_6, p9 = P0_0, p10 = P0_1, p11 =
+    P0_18, p12 = P0_17, p13 = P0_15, p14 = P0_16, p15 = P0_23, p16 = P0_24,
+    p17 = P0_25, p18 = P0_26, p19 = P1_30, p20 = P1_31, p21 = P2_5, p22 =
+    P2_4, p23 = P2_3, p24 = P2_2, p25 = P2_1, p26 = P2_0, p27 = P0_11, p28 =
+    P0_10, p29 = P0_5, p30 = P0_4,
+
+    USBTX = P0_2, USBRX = P0_3,
+    NC = -1
+} PinName;
+
+typedef enum {PullUp, PullDown, PullNone, OpenDrain} PinMode;
+
+typedef enum {Port0 = 0, Port1, Port2, Port3, Port4} PortName;
+
+extern uint32_t SystemCoreClock;
+
+// virtual clock
+unsigned long long simNowNs();
+void simAdvanceNs(unsigned long long ns);
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+// fatal run-time error, printed on stderr and the program ends
+void error(const char* format, ...);
+
+// DWT cycle counter, derived from the virtual clock
+struct SimCycleCounter
+{
+    operator uint32_t() const;
+};
+
+typedef struct
+{
+    uint32_t CTRL;
+    SimCycleCounter CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type simDWT;
+extern CoreDebug_Type simCoreDebug;
+
+#define DWT                         (&simDWT)
+#define CoreDebug                   (&simCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+// there are no interrupts on the host, just remember the mask
+uint32_t __get_PRIMASK();
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq();
+void __enable_irq();
+
+void pin_mode(PinName pin, PinMode mode);
+
+// a pin with a OneWireBusModel behind it drives and samples that bus,
+// any other pin reads back high as if pulled up
+class DigitalInOut
+{
+public:
+    DigitalInOut(PinName pin);
+
+    void output();
+    void input();
+    void mode(PinMode pull);
+    void write(int value);
+    int read();
+
+    DigitalInOut& operator= (int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    PinName pin;
+    bool isOutput;
+    int level;
+
+    void update();
+};
+
+// every port bit with a OneWireBusModel behind it is open drain on that bus
+class PortInOut
+{
+public:
+    PortInOut(PortName port, int mask = 0xFFFFFFFF);
+
+    void write(int value);
+    int read();
+    void output();
+    void input();
+    void mode(PinMode pull);
+
+    PortInOut& operator= (int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    PortName port;
+    int mask;
+    bool isOutput;
+    int level;
+
+    void update();
+};
+
+class SerialBase
+{
+public:
+    enum Parity {None = 0, Odd, Even, Forced1, Forced0};
+};
+
+// on USBTX this is stdout, on a pin with a OneWireBusModel every byte is
+// clocked onto the bus bit by bit and the echo read back, like the real
+// UART transport with tx tied to rx
+class Serial : public SerialBase
+{
+public:
+    Serial(PinName tx, PinName rx, const char* name = NULL);
+
+    void baud(int baudrate);
+    void format(int bits = 8, Parity parity = SerialBase::None, int stop_bits = 1);
+    int putc(int c);
+    int getc();
+    int readable();
+    int printf(const char* format, ...);
+
+private:
+    PinName txPin;
+    int bitNs;
+    unsigned char echo[16];
+    int echoHead;
+    int echoCount;
+};
+
+class LocalFileSystem
+{
+public:
+    LocalFileSystem(const char* name) { (void)name; }
+};
+
+#endif
@@ -37,7 +37,47 @@
   * @param type  Sets the panel size/addressing mode (default = LCD16x2)
   * @param ctrl  LCD controller (default = HD44780)           
   */
-TextLCD_Base::TextLCD_Base(LCDType type, LCDCtrl ctrl) : _type(type), _ctrl(ctrl) {
+TextLCD_Base::TextLCD_Base(LCDType type, LCDCtrl ctrl) : _type(type), _ctrl(ctrl), _busy(BusyDelay), _busTime(0), _refresh(RefreshDirect),
+                                                        _transfer(TransferBlocking), _queue(NULL), _qHead(0), _qTail(0), _pumping(false), _paused(false) {
+
+  _row=0;          // Cursor location
+  _column=0;
+  _addr=-1;        // LCD memoryaddress unknown
+
+  // CG-RAM content unknown, no glyphs loaded
+  for (int i = 0; i < D_LCD_UDC; i++) {
+    memset(_udc[i], 0, 8);
+    _udcUsed[i] = 0;
+  }
+  _udcClock = 0;
+
+  // Framebuffer for the panel size, the LCD starts out cleared
+  _frame = new char[rows() * columns()];
+  _shown = new char[rows() * columns()];
+  memset(_frame, ' ', rows() * columns());
+  memset(_shown, ' ', rows() * columns());
+
+  // Screen 0 uses the framebuffer, the others get one when first selected
+  for (int i = 0; i < D_LCD_SCREENS; i++) {
+    _screens[i] = NULL;
+    _screenColumn[i] = 0;
+    _screenRow[i] = 0;
+  }
+  _screens[0] = _frame;
+  _screen = 0;
+  _visible = 0;
+}
+
+/** Destruct a TextLCD_Base interface
+  * The derived classes sync() first, the queue is drained by their bus methods which are gone by now
+  */
+TextLCD_Base::~TextLCD_Base() {
+  _timeout.detach();
+  delete[] _queue;
+  for (int i = 0; i < D_LCD_SCREENS; i++) {
+    delete[] _screens[i];
+  }
+  delete[] _shown;
 }
 
 
@@ -54,8 +94,7 @@ void TextLCD_Base::_init() {
     
     // Secondary LCD controller Clearscreen
     _writeCommand(0x01);       // cls, and set cursor to 0    
-    wait_ms(10);     // The CLS command takes 1.64 ms.
-                     // Since we are not using the Busy flag, Lets be safe and take 10 ms
+                               // _writeCommand() waits the 1.64 ms the CLS command takes
     
   }
     
@@ -66,9 +105,7 @@ void TextLCD_Base::_init() {
   
   // Primary LCD controller Clearscreen
   _writeCommand(0x01);       // cls, and set cursor to 0
-
-  wait_ms(10);     // The CLS command takes 1.64 ms.
-                   // Since we are not using the Busy flag, Lets be safe and take 10 ms
+                             // _writeCommand() waits the 1.64 ms the CLS command takes
     
 } 
 
@@ -213,6 +250,16 @@ void TextLCD_Base::_initCtrl() {
   */
 void TextLCD_Base::cls() {
 
+  // Clear the framebuffer
+  memset(_frame, ' ', rows() * columns());
+
+  // Buffered or not visible: flush() sends the blanks that are not on the LCD yet
+  if (!_direct()) {
+    _row=0;          // Reset Cursor location
+    _column=0;
+    return;
+  }
+
   // Select and configure second LCD controller when needed
   if(_type==LCD40x4) {
     _ctrl_idx=_LCDCtrl_1; // Select 2nd controller
@@ -222,24 +269,21 @@ void TextLCD_Base::cls() {
 
     // Second LCD controller Clearscreen
     _writeCommand(0x01); // cls, and set cursor to 0    
-
-    wait_ms(10);     // The CLS command takes 1.64 ms.
-                     // Since we are not using the Busy flag, Lets be safe and take 10 ms
-
+                         // _writeCommand() waits the 1.64 ms the CLS command takes
   
     _ctrl_idx=_LCDCtrl_0; // Select primary controller
   }
   
   // Primary LCD controller Clearscreen
   _writeCommand(0x01); // cls, and set cursor to 0
-
-  wait_ms(10);     // The CLS command takes 1.64 ms.
-                   // Since we are not using the Busy flag, Lets be safe and take 10 ms
+                       // _writeCommand() waits the 1.64 ms the CLS command takes
 
   // Restore cursormode on primary LCD controller when needed
   if(_type==LCD40x4) {
     _setCursorAndDisplayMode(_currentMode,_currentCursor);     
   }
+
+  memset(_shown, ' ', rows() * columns());
                    
   _row=0;          // Reset Cursor location
   _column=0;
@@ -261,39 +305,9 @@ void TextLCD_Base::locate(int column, int row) {
 
 /** Write a single character (Stream implementation)
   */
+// The panel geometry comes from the runtime LCDType, see TextLCD_I2C_T for the compile time version
 int TextLCD_Base::_putc(int value) {
-  int addr;
-    
-    if (value == '\n') {
-      //No character to write
-      
-      //Update Cursor      
-      _column = 0;
-      _row++;
-      if (_row >= rows()) {
-        _row = 0;
-      }      
-    }
-    else {
-      //Character to write      
-      _writeData(value); 
-              
-      //Update Cursor
-      _column++;
-      if (_column >= columns()) {
-        _column = 0;
-        _row++;
-        if (_row >= rows()) {
-          _row = 0;
-        }
-      }          
-    } //else
-
-    //Set next memoryaddress, make sure cursor blinks at next location
-    addr = getAddress(_column, _row);
-    _writeCommand(0x80 | addr);
-            
-    return value;
+    return _putChar(*this, value);
 }
 
 
@@ -341,21 +355,244 @@ void TextLCD_Base::_writeByte(int value) {
 // Write a command byte to the LCD controller
 void TextLCD_Base::_writeCommand(int command) {
 
-    this->_setRS(false);        
-    wait_us(1);  // Data setup time for RS       
+    // Keep track of the memoryaddress
+    // Before waiting for the command, so a stuck Busy flag leaves it unknown
+    if (command & 0x80) {
+      _addr = command & 0x7F;   // Set DD-RAM address
+    }
+    else if ((command & 0xC0) == 0x40) {
+      _addr = -1;               // Set CG-RAM address
+    }
+    else if ((command == 0x01) || (command == 0x02)) {
+      _addr = 0;                // cls or home
+    }
+
+    if (_transfer == TransferQueued) {
+      _enqueue(command);
+    }
+    else {
+      this->_setRS(false);        
+      wait_us(1);  // Data setup time for RS       
     
-    this->_writeByte(command);   
-    wait_us(40); // most instructions take 40us            
+      this->_writeByte(command);   
+      _waitReady(_execTime(command));
+    }
 }
 
 // Write a data byte to the LCD controller
 void TextLCD_Base::_writeData(int data) {
 
-    this->_setRS(true);            
-    wait_us(1);  // Data setup time for RS 
+    if (_transfer == TransferQueued) {
+      _enqueue(D_LCD_QUEUE_RS | (data & 0xFF));
+    }
+    else {
+      this->_setRS(true);            
+      wait_us(1);  // Data setup time for RS 
         
-    this->_writeByte(data);
-    wait_us(40); // data writes take 40us                
+      this->_writeByte(data);
+      _waitReady(40); // data writes take 40us                
+    }
+
+    // The memoryaddress autoincrements
+    if (_addr >= 0) {
+      _addr++;
+    }
+}
+
+
+// Wait until the LCD controller has executed the last instruction
+// us is the execution time of the instruction, the time the bus takes to get the next one to the LCD counts towards it.
+// With the Busy flag enabled longer instructions poll the controller. When the flag can not be read, or does not
+// clear within twice the execution time, the Busy flag is disabled and the execution times are used from then on.
+void TextLCD_Base::_waitReady(int us) {
+
+    if (us <= _busTime) {
+      return;
+    }
+
+    if (_busy == BusyFlag) {
+      Timer timer;
+      timer.start();
+      do {
+        int busy = _readBusy();
+        if (busy == 0) {
+          return;
+        }
+        if (busy < 0) {
+          break;
+        }
+      } while (timer.read_us() < (2 * us));
+
+      // Busy flag stuck, give up on it. Without RW the reads went in as Set DD-RAM address commands,
+      // so the memoryaddress is unknown and the next write (_putChar(), flush()) sets it first
+      _busy = BusyDelay;
+      _addr = -1;
+      if (timer.read_us() >= us) {
+        return;
+      }
+    }
+
+    wait_us(us - _busTime);
+}
+
+// Execution time in us of a command
+// cls and home take 1.64ms, most instructions take 40us
+int TextLCD_Base::_execTime(int command) {
+
+    if ((command == 0x01) || (command == 0x02)) {
+      return 1640;
+    }
+    return 40;
+}
+
+// Read the Busy flag (Stub)
+// Returns 1 when busy, 0 when ready and -1 when the bus can not read from the LCD
+int TextLCD_Base::_readBusy() {
+    return -1;
+}
+
+// Write a string of data bytes to the LCD controller
+void TextLCD_Base::_writeString(const char *data, int count) {
+
+    if (_transfer == TransferQueued) {
+      for (int i = 0; i < count; i++) {
+        _enqueue(D_LCD_QUEUE_RS | (data[i] & 0xFF));
+      }
+    }
+    else {
+      this->_setRS(true);            
+      wait_us(1);  // Data setup time for RS 
+
+      this->_writeBytes(data, count);
+      _waitReady(40); // data writes take 40us                
+    }
+
+    // The memoryaddress autoincrements after each byte
+    if (_addr >= 0) {
+      _addr += count;
+    }
+}
+
+// Write data bytes using the 4-bit interface, RS is already set
+void TextLCD_Base::_writeBytes(const char *data, int count) {
+
+    for (int i = 0; i < count; i++) {
+      if (i > 0) {
+        _waitReady(40); // data writes take 40us                
+      }
+      this->_writeByte(data[i]);
+    }
+}
+
+// Add an instruction to the queue and start sending it when the queue was idle
+// Waits for the Timeout interrupt to make room when the queue is full
+void TextLCD_Base::_enqueue(int entry) {
+    int next = (_qTail + 1) % D_LCD_QUEUE;
+
+    // Note which controller the instruction is for, mainly used for LCD40x4
+    if (_ctrl_idx == _LCDCtrl_1) {
+      entry |= D_LCD_QUEUE_E2;
+    }
+
+    while (next == _qHead) {
+      wait_us(10);  // Queue full
+    }
+    _queue[_qTail] = entry;
+    _qTail = next;
+
+    __disable_irq();
+    if (!_pumping) {
+      _pumping = true;
+      _timeout.attach_us(this, &TextLCD_Base::_pump, 1);
+    }
+    __enable_irq();
+}
+
+// Send the next queued instruction (Timeout interrupt)
+// Up to D_LCD_QUEUE_BATCH consecutive data bytes go out together. The next interrupt is scheduled when the
+// instruction has been executed, the queue is idle again after the execution time of the last one.
+void TextLCD_Base::_pump() {
+    char data[D_LCD_QUEUE_BATCH];
+    int entry, flags, count, us;
+    _LCDCtrl_Idx current_ctrl_idx = _ctrl_idx; // Temp save current controller
+
+    if ((_qHead == _qTail) || _paused) {
+      _pumping = false;
+      return;
+    }
+
+    entry = _queue[_qHead];
+    _ctrl_idx = (entry & D_LCD_QUEUE_E2) ? _LCDCtrl_1 : _LCDCtrl_0;
+
+    if (entry & D_LCD_QUEUE_RS) {
+      // Data bytes for the same controller
+      flags = entry & ~0xFF;
+      count = 0;
+      do {
+        data[count++] = entry & 0xFF;
+        _qHead = (_qHead + 1) % D_LCD_QUEUE;
+        entry = _queue[_qHead];
+      } while ((count < D_LCD_QUEUE_BATCH) && (_qHead != _qTail) && ((entry & ~0xFF) == flags));
+
+      this->_setRS(true);
+      this->_writeBytes(data, count);
+      us = 40;
+    }
+    else {
+      this->_setRS(false);
+      this->_writeByte(entry & 0xFF);
+      us = _execTime(entry & 0xFF);
+      _qHead = (_qHead + 1) % D_LCD_QUEUE;
+    }
+
+    // Restore current controller
+    _ctrl_idx = current_ctrl_idx;
+
+    us = us - _busTime;
+    if (us < 1) {
+      us = 1;
+    }
+    _timeout.attach_us(this, &TextLCD_Base::_pump, us);
+}
+
+// Set the Transfermode (Blocking/Queued)
+void TextLCD_Base::setTransfer(LCDTransfer transferMode) {
+
+    if (transferMode == TransferQueued) {
+      if (_queue == NULL) {
+        _queue = new unsigned short[D_LCD_QUEUE];
+      }
+    }
+    else {
+      sync();
+    }
+    _transfer = transferMode;
+}
+
+// Wait until the queued instructions have been sent and executed
+void TextLCD_Base::sync() {
+
+    while (_pumping) {
+      wait_us(10);  // Timeout interrupt is draining the queue
+    }
+}
+
+void TextLCD_Base::pause() {
+
+    // The interrupt runs to completion, so after this no batch is on the bus. A Timeout that
+    // is still due only clears _pumping
+    _paused = true;
+}
+
+void TextLCD_Base::resume() {
+
+    __disable_irq();
+    _paused = false;
+    if (!_pumping && (_qHead != _qTail)) {
+      _pumping = true;
+      _timeout.attach_us(this, &TextLCD_Base::_pump, 1);
+    }
+    __enable_irq();
 }
 
 
@@ -490,6 +727,7 @@ int TextLCD_Base::getAddress(int column, int row) {
 
               // Select primary controller
               _ctrl_idx = _LCDCtrl_0;
+              _addr = -1;
 
               // Restore cursormode on primary LCD controller
               _setCursorAndDisplayMode(_currentMode, _currentCursor);    
@@ -506,6 +744,7 @@ int TextLCD_Base::getAddress(int column, int row) {
 
               // Select secondary controller
               _ctrl_idx = _LCDCtrl_1;
+              _addr = -1;
 
               // Restore cursormode on secondary LCD controller
               _setCursorAndDisplayMode(_currentMode, _currentCursor);    
@@ -541,13 +780,19 @@ void TextLCD_Base::setAddress(int column, int row) {
       _row = rows() - 1;
     } else _row = row;
     
+// Buffered or not visible: flush() sets the address
+    if (!_direct()) {
+      return;
+    }
     
 // Compute the memory address
 // For LCD40x4:  switch controllers if needed
 //               switch cursor if needed
     int addr = getAddress(_column, _row);
     
-    _writeCommand(0x80 | addr);
+    if (addr != _addr) {
+      _writeCommand(0x80 | addr);
+    }
 }
 
 int TextLCD_Base::columns() {
@@ -680,6 +925,9 @@ void TextLCD_Base::_setCursorAndDisplayMode(LCDMode displayMode, LCDCursor curso
 // Set the Backlight mode (Off/On)
 void TextLCD_Base::setBacklight(LCDBacklight backlightMode) {
 
+    // Keep the bus to ourselves
+    sync();
+
     if (backlightMode == LightOn) {
       this->_setBL(true);
     }
@@ -690,6 +938,10 @@ void TextLCD_Base::setBacklight(LCDBacklight backlightMode) {
 
 
 void TextLCD_Base::setUDC(unsigned char c, char *udc_data) {
+
+  // Remember what the UDC holds for glyph()
+  memcpy(_udc[c & 0x07], udc_data, 8);
+  _udcUsed[c & 0x07] = ++_udcClock;
   
   // Select and configure second LCD controller when needed
   if(_type==LCD40x4) {
@@ -709,6 +961,7 @@ void TextLCD_Base::setUDC(unsigned char c, char *udc_data) {
 
     // Restore current controller
     _ctrl_idx=current_ctrl_idx;       
+    _addr=-1;
   }
   else {
     // Configure primary LCD controller
@@ -717,6 +970,157 @@ void TextLCD_Base::setUDC(unsigned char c, char *udc_data) {
     
 }
 
+// Get the UDC showing a glyph, load it into the least recently requested UDC when needed
+int TextLCD_Base::glyph(const char *udc_data) {
+  int lru = 0;
+
+  for (int i = 0; i < D_LCD_UDC; i++) {
+    // By content, the udc_ arrays in TextLCD.h are a separate copy in each file that includes it
+    if ((_udcUsed[i] != 0) && (memcmp(_udc[i], udc_data, 8) == 0)) {
+      // Loaded already, no CG-RAM write
+      _udcUsed[i] = ++_udcClock;
+      return i;
+    }
+    if (_udcUsed[i] < _udcUsed[lru]) {
+      lru = i;
+    }
+  }
+
+  setUDC(lru, (char *) udc_data);
+  return lru;
+}
+
+// Set the Busymode (Delay/Flag)
+void TextLCD_Base::setBusy(LCDBusy busyMode) {
+
+  // Keep the bus to ourselves
+  sync();
+
+  _busy = BusyDelay;
+
+  if (busyMode == BusyFlag) {
+    // The last instruction has been waited for, so the Busy flag must read clear.
+    // It reads set when RW is not connected, the read was then taken as a Set DD-RAM address command.
+    if (_readBusy() == 0) {
+      _busy = BusyFlag;
+    }
+    else {
+      _addr = -1;
+    }
+  }
+}
+
+// Set the Refreshmode (Direct/Buffered)
+void TextLCD_Base::setRefresh(LCDRefresh refreshMode) {
+
+  bool leaveBuffered = (_refresh == RefreshBuffered) && (refreshMode == RefreshDirect);
+
+  _refresh = refreshMode;
+
+  // Bring the LCD up to date before writing to it directly again
+  if (leaveBuffered) {
+    flush();
+    setAddress(_column, _row);
+  }
+}
+
+// Send the cells that differ between framebuffer and LCD.
+// The LCD autoincrements the memoryaddress, so a run of changed cells needs one set-address command.
+// A run ends at the first unchanged cell or where the memoryaddress is not contiguous (e.g. LCD16x1).
+void TextLCD_Base::flush() {
+  int cell, addr, count;
+  char *frame = _screens[_visible];
+  
+  for (int row = 0; row < rows(); row++) {
+    int column = 0;
+    while (column < columns()) {
+      cell = (row * columns()) + column;
+      if (frame[cell] == _shown[cell]) {
+        column++;
+        continue;
+      }
+
+      // Start of a run
+      // For LCD40x4: getAddress() switches controllers if needed
+      addr = getAddress(column, row);
+      count = 1;
+      while ((column + count < columns()) &&
+             (frame[cell + count] != _shown[cell + count]) &&
+             (getAddress(column + count, row) == addr + count)) {
+        count++;
+      }
+
+      // No command needed when the previous run ended just in front (e.g. rows 0 and 2 of LCD20x4)
+      if (addr != _addr) {
+        _writeCommand(0x80 | addr);
+      }
+      _writeString(&frame[cell], count);
+      memcpy(&_shown[cell], &frame[cell], count);
+
+      column += count;
+    }
+  }
+
+  //Restore memoryaddress, make sure cursor blinks at current location of the visible screen
+  if (_visible == _screen) {
+    addr = getAddress(_column, _row);
+  }
+  else {
+    addr = getAddress(_screenColumn[_visible], _screenRow[_visible]);
+  }
+  if (addr != _addr) {
+    _writeCommand(0x80 | addr);
+  }
+}
+
+// Get the framebuffer of a screen, a new one is blank
+char *TextLCD_Base::_screenFrame(int screen) {
+
+  if (_screens[screen] == NULL) {
+    _screens[screen] = new char[rows() * columns()];
+    memset(_screens[screen], ' ', rows() * columns());
+  }
+  return _screens[screen];
+}
+
+// Select the screen that is written to, each one keeps its own cursor
+void TextLCD_Base::setScreen(int screen) {
+
+  if ((screen < 0) || (screen >= D_LCD_SCREENS) || (screen == _screen)) {
+    return;
+  }
+
+  _screenColumn[_screen] = _column;
+  _screenRow[_screen] = _row;
+
+  _frame = _screenFrame(screen);
+  _screen = screen;
+  _column = _screenColumn[screen];
+  _row = _screenRow[screen];
+
+  // Direct: the LCD address was left where the visible screen was written, move it to its cursor
+  setAddress(_column, _row);
+}
+
+// Show a screen, only the cells that differ from the one on display are sent
+void TextLCD_Base::showScreen(int screen) {
+
+  if ((screen < 0) || (screen >= D_LCD_SCREENS) || (screen == _visible)) {
+    return;
+  }
+
+  _screenColumn[_screen] = _column;
+  _screenRow[_screen] = _row;
+
+  _screenFrame(screen);
+  _visible = screen;
+
+  // Buffered: the next flush() sends it
+  if (_refresh == RefreshDirect) {
+    flush();
+  }
+}
+
 void TextLCD_Base::_setUDC(unsigned char c, char *udc_data) {
   
   // Select CG RAM for current LCD controller
@@ -848,6 +1252,7 @@ void TextLCD::_setData(int value) {
   * @return none
   */ 
 TextLCD::~TextLCD() {
+   sync();                         // Drain the queue while the pins are still there
    if (_bl != NULL) {delete _bl;}  // BL pin
    if (_e2 != NULL) {delete _e2;}  // E2 pin
 }
@@ -870,6 +1275,9 @@ TextLCD_I2C::TextLCD_I2C(I2C *i2c, char deviceAddress, LCDType type, LCDCtrl ctr
                          _i2c(i2c){
                               
   _slaveAddress = deviceAddress & 0xFE;
+
+  // The next byte takes at least 2 portexpander values (2 x 9 bits, 45us at 400kHz) to reach the LCD
+  _busTime = 40;
   
   // Init the portexpander bus
   _lcd_bus = D_LCD_BUS_DEF;
@@ -881,6 +1289,13 @@ TextLCD_I2C::TextLCD_I2C(I2C *i2c, char deviceAddress, LCDType type, LCDCtrl ctr
     
 }
 
+/** Destruct a TextLCD interface using an I2C PC8574 or PCF8574A portexpander
+  * Drains the queue while the I2C bus methods are still there
+  */
+TextLCD_I2C::~TextLCD_I2C() {
+  sync();
+}
+
 // Set E pin (or E2 pin)
 // Used for mbed pins, I2C bus expander or SPI shiftregister
 void TextLCD_I2C::_setEnable(bool value) {
@@ -905,15 +1320,13 @@ void TextLCD_I2C::_setEnable(bool value) {
 
 // Set RS pin
 // Used for mbed pins, I2C bus expander or SPI shiftregister
+// Only the bus mirror is updated, the next _writeByte() or _writeBytes() sends it ahead of E
 void TextLCD_I2C::_setRS(bool value) {
 
   if (value)
     _lcd_bus |= D_LCD_RS;    // Set RS bit 
   else                     
     _lcd_bus &= ~D_LCD_RS;   // Reset RS bit                     
-
-  // write the new data to the I2C portexpander
-  _i2c->write(_slaveAddress, &_lcd_bus, 1);    
                   
 }    
 
@@ -936,35 +1349,128 @@ void TextLCD_I2C::_setBL(bool value) {
 // Place the 4bit data on the databus
 // Used for mbed pins, I2C bus expander or SPI shifregister
 void TextLCD_I2C::_setData(int value) {
+
+  _lcd_bus = _busData(value);
+                    
+  // write the new data to the I2C portexpander
+  _i2c->write(_slaveAddress, &_lcd_bus, 1);  
+                 
+}    
+
+// Portexpander value with the 4bit data on the databus, other bits from the bus mirror
+char TextLCD_I2C::_busData(int value) {
   int data;
+  char bus = _lcd_bus;
 
   // Set bit by bit to support any mapping of expander portpins to LCD pins
   
   data = value & 0x0F;
   if (data & 0x01)
-    _lcd_bus |= D_LCD_D4;   // Set Databit 
+    bus |= D_LCD_D4;   // Set Databit 
   else                     
-    _lcd_bus &= ~D_LCD_D4;  // Reset Databit                     
+    bus &= ~D_LCD_D4;  // Reset Databit                     
 
   if (data & 0x02)
-    _lcd_bus |= D_LCD_D5;   // Set Databit 
+    bus |= D_LCD_D5;   // Set Databit 
   else                     
-    _lcd_bus &= ~D_LCD_D5;  // Reset Databit                     
+    bus &= ~D_LCD_D5;  // Reset Databit                     
 
   if (data & 0x04)
-    _lcd_bus |= D_LCD_D6;   // Set Databit 
+    bus |= D_LCD_D6;   // Set Databit 
   else                     
-    _lcd_bus &= ~D_LCD_D6;  // Reset Databit                     
+    bus &= ~D_LCD_D6;  // Reset Databit                     
 
   if (data & 0x08)
-    _lcd_bus |= D_LCD_D7;   // Set Databit 
+    bus |= D_LCD_D7;   // Set Databit 
   else                     
-    _lcd_bus &= ~D_LCD_D7;  // Reset Databit                     
-                    
-  // write the new data to the I2C portexpander
-  _i2c->write(_slaveAddress, &_lcd_bus, 1);  
-                 
-}    
+    bus &= ~D_LCD_D7;  // Reset Databit                     
+
+  return bus;
+}
+
+// Fill in the portexpander values that clock a byte into the LCD, high nibble first
+// E is raised with the data and dropped again, the falling edge latches the nibble
+// Returns the number of values, the bus mirror is left at the last one
+int TextLCD_I2C::_busByte(char *bus, int value) {
+  char enable = (_ctrl_idx==_LCDCtrl_0) ? D_LCD_E : D_LCD_E2;
+
+  _lcd_bus &= ~enable;
+  
+  _lcd_bus = _busData(value >> 4);   // High nibble
+  bus[0] = _lcd_bus | enable;
+  bus[1] = _lcd_bus;
+
+  _lcd_bus = _busData(value >> 0);   // Low nibble
+  bus[2] = _lcd_bus | enable;
+  bus[3] = _lcd_bus;
+
+  return 4;
+}
+
+// Read the Busy flag on D7
+// RW must be connected to the portexpander, so not on LCD40x4 where the RW pin is used for E2
+// Returns 1 when busy, 0 when ready and -1 when the bus can not read from the LCD
+int TextLCD_I2C::_readBusy() {
+  char bus[3];
+  char data;
+
+  if (_type == LCD40x4) {
+    return -1;
+  }
+
+  // Databus pins high so the portexpander can read them, RS low and RW high to read the Busy flag
+  _lcd_bus = (_lcd_bus | D_LCD_BUS_MSK | D_LCD_RW) & ~(D_LCD_RS | D_LCD_E);
+  bus[0] = _lcd_bus;
+  bus[1] = _lcd_bus | D_LCD_E;
+  _i2c->write(_slaveAddress, bus, 2);
+
+  // High nibble holds the Busy flag
+  _i2c->read(_slaveAddress, &data, 1);
+
+  // Clock out the Low nibble (address counter, not used) to keep the 4-bit interface in step
+  bus[0] = _lcd_bus;
+  bus[1] = _lcd_bus | D_LCD_E;
+  bus[2] = _lcd_bus;
+  _i2c->write(_slaveAddress, bus, 3);
+
+  // RW goes low again with the next write, ahead of E
+  _lcd_bus &= ~D_LCD_RW;
+
+  return (data & D_LCD_D7) ? 1 : 0;
+}
+
+// Write a byte using the 4-bit interface in one I2C transfer
+// The first value puts RS on the bus before E goes high.
+// Each portexpander value takes 9 I2C clocks (90us at the 100kHz PCF8574 limit), which covers the E timing.
+void TextLCD_I2C::_writeByte(int value) {
+  char bus[5];
+
+  bus[0] = _lcd_bus;
+  _busByte(&bus[1], value);
+
+  // write the sequence to the I2C portexpander
+  _i2c->write(_slaveAddress, bus, 5);
+}
+
+// Write data bytes using the 4-bit interface, D_LCD_I2C_BATCH bytes per I2C transfer, RS is already set
+// The 4 portexpander values per byte take longer than the 40us the LCD needs to store it.
+void TextLCD_I2C::_writeBytes(const char *data, int count) {
+  char bus[1 + (4 * D_LCD_I2C_BATCH)];
+  int length, n;
+
+  for (int i = 0; i < count; i += n) {
+    n = ((count - i) < D_LCD_I2C_BATCH) ? (count - i) : D_LCD_I2C_BATCH;
+
+    length = 0;
+    bus[length++] = _lcd_bus;
+    for (int j = 0; j < n; j++) {
+      length += _busByte(&bus[length], data[i + j]);
+    }
+
+    // write the sequence to the I2C portexpander
+    _i2c->write(_slaveAddress, bus, length);
+  }
+}
 
 //---------- End TextLCD_I2C ------------
 
@@ -1003,6 +1509,13 @@ TextLCD_SPI::TextLCD_SPI(SPI *spi, PinName cs, LCDType type, LCDCtrl ctrl) :
     
 }
 
+/** Destruct a TextLCD interface using an SPI 74595 portexpander
+  * Drains the queue while the SPI bus methods are still there
+  */
+TextLCD_SPI::~TextLCD_SPI() {
+  sync();
+}
+
 // Set E pin (or E2 pin)
 // Used for mbed pins, I2C bus expander or SPI shiftregister
 void TextLCD_SPI::_setEnable(bool value) {
@@ -1154,6 +1667,7 @@ TextLCD_SPI_N::TextLCD_SPI_N(SPI *spi, PinName cs, PinName rs, LCDType type, Pin
 }
 
 TextLCD_SPI_N::~TextLCD_SPI_N() {
+   sync();                         // Drain the queue while the pins are still there
    if (_bl != NULL) {delete _bl;}  // BL pin
 }
 
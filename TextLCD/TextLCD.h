@@ -112,12 +112,29 @@
 #define D_LCD_E        (1<<D_LCD_PIN_E)
 #define D_LCD_E2       (1<<D_LCD_PIN_E2)
 #define D_LCD_BL       (1<<D_LCD_PIN_BL)
-//#define D_LCD_RW       (1<<D_LCD_PIN_RW)
+#define D_LCD_RW       (1<<D_LCD_PIN_RW)
 
 
 #define D_LCD_BUS_MSK  (D_LCD_D4 | D_LCD_D5 | D_LCD_D6 | D_LCD_D7)
 #define D_LCD_BUS_DEF  0x00
 
+//Max number of characters per I2C transfer for I2C PCF8574 (4 portexpander values per character)
+#define D_LCD_I2C_BATCH  20
+
+//Queued transfers: number of instructions in the queue and max number of data bytes sent per interrupt
+#define D_LCD_QUEUE        128
+#define D_LCD_QUEUE_BATCH  4
+
+//Queue entry bits next to the instruction byte
+#define D_LCD_QUEUE_RS     0x100
+#define D_LCD_QUEUE_E2     0x200
+
+//Number of User Defined Chars in CG-RAM
+#define D_LCD_UDC          8
+
+//Number of virtual screens, a framebuffer is allocated for each one when first selected
+#define D_LCD_SCREENS      8
+
 
 /** Some sample User Defined Chars 5x7 dots */
 const char udc_ae[] = {0x00, 0x00, 0x1B, 0x05, 0x1F, 0x14, 0x1F, 0x00};  //æ
@@ -155,11 +172,11 @@ const char udc_AC[]     = {0x0A, 0x0A, 0x1F, 0x11, 0x0E, 0x04, 0x04, 0x00};  //
 //const char udc_droopy[] = {0x00, 0x0A, 0x00, 0x04, 0x00, 0x0E, 0x11, 0x00};  // Droopey
 //const char udc_note[]   = {0x01, 0x03, 0x05, 0x09, 0x0B, 0x1B, 0x18, 0x00};  // Note
 
-//const char udc_bar_1[]  = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00};  // Bar 1
-//const char udc_bar_2[]  = {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00};  // Bar 11
-//const char udc_bar_3[]  = {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x00};  // Bar 111
-//const char udc_bar_4[]  = {0x17, 0x17, 0x17, 0x17, 0x17, 0x17, 0x17, 0x00};  // Bar 1111
-//const char udc_bar_5[]  = {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x00};  // Bar 11111
+const char udc_bar_1[]  = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00};  // Bar 1
+const char udc_bar_2[]  = {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00};  // Bar 11
+const char udc_bar_3[]  = {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x00};  // Bar 111
+const char udc_bar_4[]  = {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x00};  // Bar 1111
+const char udc_bar_5[]  = {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x00};  // Bar 11111
 const char udc_bar_6[]  = {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F};
 
 /** A TextLCD interface for driving 4-bit HD44780-based LCDs
@@ -220,6 +237,24 @@ public:
         LightOn          /**<  Backlight On */            
     };
 
+   /** LCD Busy control */
+    enum LCDBusy {
+        BusyDelay,       /**<  Wait the execution time of each instruction */    
+        BusyFlag         /**<  Read the Busy flag, RW must be connected */            
+    };
+
+   /** LCD Transfer control */
+    enum LCDTransfer {
+        TransferBlocking, /**<  Instructions are sent before the call returns */    
+        TransferQueued    /**<  Instructions are queued and sent from a Timeout interrupt */            
+    };
+
+   /** LCD Refresh control */
+    enum LCDRefresh {
+        RefreshDirect,   /**<  Characters are sent to the LCD as they are written */    
+        RefreshBuffered  /**<  Characters are kept in the framebuffer until flush() */            
+    };
+
 
 #if DOXYGEN_ONLY
     /** Write a character to the LCD
@@ -304,6 +339,80 @@ public:
      */
     void setUDC(unsigned char c, char *udc_data);
 
+    /** Get the UDC showing a glyph
+     *  The glyph is known by its bitpatterns, wherever they are stored, and is only written to CG-RAM when not loaded yet,
+     *  replacing the least recently requested glyph when all UDCs are taken.
+     *  Request the glyphs of a screen each time it is drawn, so the glyphs on display are not replaced.
+     *
+     * @param udc_data    The bitpatterns for the UDC (8 bytes of 5 significant bits)
+     * @param return      The Index of the UDC (0..7) to print
+     */
+    int glyph(const char *udc_data);
+
+
+    /** Set the Busymode
+     *  Stays at BusyDelay when the Busy flag can not be read
+     *
+     *  @param busyMode The Busy mode (BusyDelay, BusyFlag)
+     */
+    void setBusy(LCDBusy busyMode); 
+
+    /** Set the Refreshmode
+     *
+     *  @param refreshMode The Refresh mode (RefreshDirect, RefreshBuffered)
+     */
+    void setRefresh(LCDRefresh refreshMode); 
+
+    /** Send the framebuffer to the LCD
+     *  Only the cells that changed since the last flush are sent, one set-address command per run of changed cells
+     */
+    void flush();
+
+    /** Select the virtual screen that is written to
+     *  Each screen is a framebuffer with its own cursor, a screen that is not visible is only
+     *  written in its framebuffer and keeps its content until written again. Screen 0 is the one in use from the start.
+     *
+     *  @param screen The screen to write to (0..D_LCD_SCREENS-1)
+     */
+    void setScreen(int screen);
+
+    /** Make a virtual screen visible
+     *  Only the cells that differ from the screen on display are sent, right away in RefreshDirect
+     *  and on the next flush() in RefreshBuffered. The UDCs are shared by all screens.
+     *
+     *  @param screen The screen to show (0..D_LCD_SCREENS-1)
+     */
+    void showScreen(int screen);
+
+
+    /** Set the Transfermode
+     *  While queued the bus must not be used by anything else. The Timeout interrupt sends each
+     *  batch with blocking bus writes, up to about 1.8 ms on I2C, so timing critical code such as
+     *  a 1-Wire transaction must run between pause() and resume() or after sync()
+     *
+     *  @param transferMode The Transfer mode (TransferBlocking, TransferQueued)
+     */
+    void setTransfer(LCDTransfer transferMode); 
+
+    /** Wait until all queued instructions have been sent to the LCD
+     */
+    void sync();
+
+    /** Stop the Timeout interrupt from sending, the queue is kept
+     *  On return no batch is in progress and none starts until resume(). Wrap it tightly around
+     *  the timing critical code, do not write to the LCD in between: a full queue would wait forever
+     */
+    void pause();
+
+    /** Send the queued instructions again after pause()
+     */
+    void resume();
+
+
+    /** Destruct a TextLCD_Base interface
+     */
+    virtual ~TextLCD_Base();
+
 
 protected:
 
@@ -327,6 +436,9 @@ protected:
     virtual int _putc(int value);
     virtual int _getc();
 
+    // Write a single character, geometry provides columns(), rows() and getAddress() for the panel
+    template<class Geometry> int _putChar(Geometry &geometry, int value);
+
 /** Low level methods for LCD controller
   */
     void _init();    
@@ -335,6 +447,7 @@ protected:
     void _setCursor(LCDCursor show);
     void _setUDC(unsigned char c, char *udc_data);   
     void _setCursorAndDisplayMode(LCDMode displayMode, LCDCursor cursorType);       
+    char *_screenFrame(int screen);
     
 /** Low level write operations to LCD controller
   */
@@ -342,6 +455,16 @@ protected:
     virtual void _writeByte(int value);
     void _writeCommand(int command);
     void _writeData(int data);
+    void _writeString(const char *data, int count);
+    virtual void _writeBytes(const char *data, int count);
+    void _waitReady(int us);
+    int  _execTime(int command);
+    virtual int _readBusy();
+
+/** Queued transfers
+  */
+    void _enqueue(int entry);
+    void _pump();
 
 /** Pure Virtual Low level writes to LCD Bus (serial or parallel)
   */
@@ -367,8 +490,105 @@ protected:
     int _column;
     int _row;
     LCDCursor _currentCursor;    
+
+// Memoryaddress of the current LCD controller, -1 when unknown
+    int _addr;
+
+// Busy mode
+    LCDBusy _busy;
+
+// Minimum time in us the bus takes to get the next byte to the LCD, shorter waits are skipped
+    int _busTime;
+
+// UDCs, the bitpatterns loaded in each and when they were last requested (0 when never)
+    char _udc[D_LCD_UDC][8];
+    unsigned int _udcUsed[D_LCD_UDC];
+    unsigned int _udcClock;
+
+// Framebuffer, rows() x columns() characters
+//   _frame is what has been written, _shown is what the LCD is displaying
+    LCDRefresh _refresh;
+    char *_frame;
+    char *_shown;
+
+// Virtual screens, _frame is the framebuffer of _screen
+//   flush() sends the one of _visible, the cursor of the screens not selected is kept in _screenColumn/_screenRow
+    char *_screens[D_LCD_SCREENS];
+    int _screenColumn[D_LCD_SCREENS];
+    int _screenRow[D_LCD_SCREENS];
+    int _screen;
+    int _visible;
+
+// Written straight to the LCD: RefreshDirect and the selected screen is visible
+    bool _direct() { return (_refresh == RefreshDirect) && (_screen == _visible); }
+
+// Transfer queue, drained by the Timeout interrupt
+    LCDTransfer _transfer;
+    unsigned short *_queue;
+    volatile int _qHead;
+    volatile int _qTail;
+    volatile bool _pumping;
+    volatile bool _paused;
+    Timeout _timeout;
 };
 
+/** Write a single character
+  * Shared by the Stream implementation of TextLCD_Base and TextLCD_I2C_T,
+  * inline so a compile time geometry folds into the address computation
+  */
+template<class Geometry>
+int TextLCD_Base::_putChar(Geometry &geometry, int value) {
+  int addr;
+    
+    if (value == '\n') {
+      //No character to write
+      
+      //Update Cursor      
+      _column = 0;
+      _row++;
+      if (_row >= geometry.rows()) {
+        _row = 0;
+      }      
+    }
+    else {
+      //Character to write      
+      _frame[(_row * geometry.columns()) + _column] = value;
+
+      if (_direct()) {
+        //Memoryaddress unknown (-1) or moved, e.g. after a CG-RAM write or a stuck Busy flag
+        addr = geometry.getAddress(_column, _row);
+        if (addr != _addr) {
+          _writeCommand(0x80 | addr);
+        }
+        _writeData(value); 
+        _shown[(_row * geometry.columns()) + _column] = value;
+      }
+              
+      //Update Cursor
+      _column++;
+      if (_column >= geometry.columns()) {
+        _column = 0;
+        _row++;
+        if (_row >= geometry.rows()) {
+          _row = 0;
+        }
+      }          
+    } //else
+
+    //Set next memoryaddress, make sure cursor blinks at next location
+    //Only needed when the autoincrement does not get there: linewraps, newlines and
+    //the non-contiguous rows of e.g. LCD20x4 or LCD40x4
+    //Buffered: flush() sets the address
+    if (_direct()) {
+      addr = geometry.getAddress(_column, _row);
+      if (addr != _addr) {
+        _writeCommand(0x80 | addr);
+      }
+    }
+            
+    return value;
+}
+
 //--------- End TextLCD_Base -----------
 
 
@@ -439,12 +659,24 @@ public:
      */
     TextLCD_I2C(I2C *i2c, char deviceAddress = 0x40, LCDType type = LCD16x2, LCDCtrl ctrl = HD44780);
 
+   /** Destruct a TextLCD interface using an I2C portexpander
+     * Waits for the queued transfers to be sent
+     */ 
+    virtual ~TextLCD_I2C();
+
 private:
 //Low level writes to LCD Bus (serial or parallel)
     virtual void _setEnable(bool value);
     virtual void _setRS(bool value);  
     virtual void _setBL(bool value);
     virtual void _setData(int value);   
+
+//Low level writes to LCD bus, batched into one I2C transfer
+    virtual void _writeByte(int value);
+    virtual void _writeBytes(const char *data, int count);
+    virtual int _readBusy();
+    char _busData(int value);
+    int  _busByte(char *bus, int value);
   
 //I2C bus
     I2C *_i2c;
@@ -460,6 +692,96 @@ private:
 
 
 
+//--------- Start TextLCD_I2C_T ---------
+
+
+/** Panel geometry for an LCDType known at compile time
+  * Same layouts as TextLCD_Base::columns(), rows() and getAddress(), as enum constants (C++98, no constexpr)
+  * LCD40x4 is not supported, it switches between 2 controllers in getAddress()
+  */
+template<TextLCD_Base::LCDType type>
+class TextLCD_Geometry {
+public:
+    enum {
+        Columns = ((type == TextLCD_Base::LCD8x1)  || (type == TextLCD_Base::LCD8x2)   || (type == TextLCD_Base::LCD8x2B))  ?  8 :
+                  ((type == TextLCD_Base::LCD12x2) || (type == TextLCD_Base::LCD12x4)) ? 12 :
+                  ((type == TextLCD_Base::LCD20x2) || (type == TextLCD_Base::LCD20x4)) ? 20 :
+                  ((type == TextLCD_Base::LCD24x2) || (type == TextLCD_Base::LCD24x4)) ? 24 :
+                  ((type == TextLCD_Base::LCD40x2) || (type == TextLCD_Base::LCD40x4)) ? 40 : 16,
+
+        Rows    = ((type == TextLCD_Base::LCD8x1)  || (type == TextLCD_Base::LCD16x1)) ? 1 :
+                  ((type == TextLCD_Base::LCD12x4) || (type == TextLCD_Base::LCD16x4)  || (type == TextLCD_Base::LCD20x4) ||
+                   (type == TextLCD_Base::LCD24x4) || (type == TextLCD_Base::LCD40x4)) ? 4 : 2,
+
+        // Memoryaddress of the first column of rows 1..3
+        Row1    = (type == TextLCD_Base::LCD8x2B)  ? 0x08 :
+                  (type == TextLCD_Base::LCD16x2B) ? 40 :
+                  (type == TextLCD_Base::LCD24x4)  ? 0x20 : 0x40,
+        Row2    = (type == TextLCD_Base::LCD12x4)  ? 0x0C :
+                  (type == TextLCD_Base::LCD16x4)  ? 0x10 :
+                  (type == TextLCD_Base::LCD20x4)  ? 0x14 : 0x40,
+        Row3    = (type == TextLCD_Base::LCD12x4)  ? 0x4C :
+                  (type == TextLCD_Base::LCD16x4)  ? 0x50 :
+                  (type == TextLCD_Base::LCD20x4)  ? 0x54 : 0x60,
+
+        // Column where the memoryaddress jumps to 0x40, LCD16x1 is a special layout of LCD8x2
+        Split   = (type == TextLCD_Base::LCD16x1)  ? 8 : Columns
+    };
+
+    int columns() { return Columns; }
+    int rows() { return Rows; }
+
+    int getAddress(int column, int row) {
+      int addr = (Rows == 1) ? 0x00 :
+                 (row == 0)  ? 0x00 :
+                 (row == 1)  ? Row1 :
+                 (row == 2)  ? Row2 : Row3;
+
+      if (column >= Split) {
+        addr += 0x40 - Split;
+      }
+      return addr + column;
+    }
+};
+
+
+/** Create a TextLCD interface using an I2C PC8574 or PCF8574A portexpander, for a panel type fixed at compile time
+  * The character writes use TextLCD_Geometry, so the address computation reduces to a few constants
+  *
+  * @code
+  * TextLCD_I2C_T<TextLCD::LCD20x4> lcd(&i2c_lcd, 0x42); // I2C bus, PCF8574 Slaveaddress
+  * @endcode
+  */
+template<TextLCD_Base::LCDType type>
+class TextLCD_I2C_T : public TextLCD_I2C {
+public:
+    /** Create a TextLCD interface using an I2C PC8574 or PCF8574A portexpander
+     *
+     * @param i2c             I2C Bus
+     * @param deviceAddress   I2C slave address (PCF8574 or PCF8574A, default = 0x40)
+     * @param ctrl            LCD controller (default = HD44780)                
+     */
+    TextLCD_I2C_T(I2C *i2c, char deviceAddress = 0x40, LCDCtrl ctrl = HD44780) :
+                  TextLCD_I2C(i2c, deviceAddress, type, ctrl) {
+    }
+
+protected:
+    // Stream implementation functions
+    virtual int _putc(int value) {
+      return _putChar(_geometry, value);
+    }
+
+private:
+    // LCD40x4 needs TextLCD_I2C
+    typedef char _noLCD40x4[(type != TextLCD_Base::LCD40x4) ? 1 : -1];
+
+    TextLCD_Geometry<type> _geometry;
+};
+
+//---------- End TextLCD_I2C_T ----------
+
+
+
 //--------- Start TextLCD_SPI -----------
 
 
@@ -477,6 +799,11 @@ public:
      */
     TextLCD_SPI(SPI *spi, PinName cs, LCDType type = LCD16x2, LCDCtrl ctrl = HD44780);
 
+   /** Destruct a TextLCD interface using an SPI portexpander
+     * Waits for the queued transfers to be sent
+     */ 
+    virtual ~TextLCD_SPI();
+
 
 private:
 //Low level writes to LCD Bus (serial or parallel)
@@ -0,0 +1,107 @@
+/* TextLCDBusyTest. Host test of where the characters land when TextLCD lost track of the
+ * LCD memoryaddress: after the Busy flag got stuck and after a CG-RAM write.
+ *
+ *   g++ -DTEXTLCD_HOST_SIM -DTEXTLCD_BUSY_TEST -ITextLCD/sim -ITextLCD \
+ *       TextLCD/TextLCD.cpp TextLCD/sim/TextLCDModel.cpp TextLCD/sim/TextLCDBusyTest.cpp
+ *
+ * The Busy flag is enabled while RW is connected, then RW is disconnected in the model. The next
+ * cls() polls a flag that stays set, and each poll goes in as a Set DD-RAM address 0x7F command.
+ * TextLCD gives up on the flag and the characters after it must still land at the cursor.
+ * Returns non-zero when a check fails.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#if defined(TEXTLCD_HOST_SIM) && defined(TEXTLCD_BUSY_TEST)
+
+#include "mbed.h"
+#include "TextLCD.h"
+#include "TextLCDModel.h"
+
+static int failures = 0;
+
+// The row as shown by TextLCDModel::row() must read as expected
+static void check(const char *what, TextLCDModel &model, int row, const char *expected) {
+  char text[41];
+
+  model.row(row, text);
+  if (strncmp(text, expected, strlen(expected)) != 0) {
+    printf("FAIL %s: row %d \"%s\", expected \"%s\"\n", what, row, text, expected);
+    failures++;
+  }
+  else {
+    printf("ok   %s\n", what);
+  }
+}
+
+// Busy flag stuck during cls(), the next characters in direct and buffered refresh
+static void stuckBusy() {
+  TextLCDModel model(0x4E, 20, 4);
+  I2C i2c(p28, p27);
+  TextLCD_I2C lcd(&i2c, 0x4E, TextLCD::LCD20x4);
+
+  lcd.setBusy(TextLCD::BusyFlag);
+  lcd.printf("stale");
+
+  // The wire to RW breaks, the flag now reads set and polling it moves the address to 0x7F
+  model.setRWConnected(false);
+  lcd.cls();
+  lcd.printf("Home");
+  check("direct write after stuck Busy flag", model, 0, "Home                ");
+
+  lcd.setAddress(3, 2);
+  lcd.printf("row 2");
+  check("direct write at an address", model, 2, "   row 2            ");
+
+  // The same with the framebuffer, the flush sets the address of each run
+  model.setRWConnected(true);
+  lcd.setBusy(TextLCD::BusyFlag);
+  lcd.setRefresh(TextLCD::RefreshBuffered);
+  model.setRWConnected(false);
+  lcd.cls();
+  lcd.flush();
+  lcd.setAddress(0, 1);
+  lcd.printf("buffered");
+  lcd.flush();
+  check("buffered write after stuck Busy flag", model, 1, "buffered            ");
+  check("buffered cls", model, 0, "                    ");
+}
+
+// A UDC written to both controllers of a 40x4 panel leaves the memoryaddress unknown
+static void udcOn40x4() {
+  const char glyph[8] = {0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F, 0x00};
+  TextLCDModel model(0x4E, 40, 4);
+  I2C i2c(p28, p27);
+  TextLCD_I2C lcd(&i2c, 0x4E, TextLCD::LCD40x4);
+
+  lcd.setAddress(10, 3);
+  lcd.setUDC(1, (char *) glyph);
+  lcd.printf("after");
+  check("direct write after a UDC on LCD40x4", model, 3, "          after");
+}
+
+int main() {
+  stuckBusy();
+  udcOn40x4();
+
+  printf("%d failed\n", failures);
+  return failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,598 @@
+/* TextLCDModel. A host side model of a PCF8574 I2C portexpander with one or two
+ * HD44780 controllers behind it, driven through the sim I2C.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifdef TEXTLCD_HOST_SIM
+
+#include "TextLCDModel.h"
+
+static unsigned long long simTime = 0;
+static bool simIrqMasked = false;
+static bool simInHandler = false;
+
+Timeout *Timeout::_list = NULL;
+TextLCDModel *TextLCDModel::_models[SIM_LCD_MAX_MODELS];
+
+
+//--------- Start virtual clock -----------
+
+unsigned long long simNowNs() {
+  return simTime;
+}
+
+// Handlers that fall due run on the way, each at its own time
+void simAdvanceNs(unsigned long long ns) {
+  unsigned long long end = simTime + ns;
+
+  Timeout::fire(end);
+
+  // A handler that ran over the end took the time it took
+  if (simTime < end) {
+    simTime = end;
+  }
+}
+
+void wait(float s) {
+  simAdvanceNs((unsigned long long)(s * 1e9f));
+}
+
+void wait_ms(int ms) {
+  simAdvanceNs((unsigned long long)ms * 1000000);
+}
+
+void wait_us(int us) {
+  simAdvanceNs((unsigned long long)us * 1000);
+}
+
+void __disable_irq() {
+  simIrqMasked = true;
+}
+
+// Handlers held back while masked run now
+void __enable_irq() {
+  simIrqMasked = false;
+  simAdvanceNs(0);
+}
+
+Timer::Timer() : _running(false), _start(0), _elapsed(0) {
+}
+
+void Timer::start() {
+  if (!_running) {
+    _start = simTime;
+    _running = true;
+  }
+}
+
+void Timer::stop() {
+  if (_running) {
+    _elapsed += simTime - _start;
+    _running = false;
+  }
+}
+
+void Timer::reset() {
+  _start = simTime;
+  _elapsed = 0;
+}
+
+int Timer::read_us() {
+  unsigned long long ns = _elapsed + (_running ? (simTime - _start) : 0);
+  return (int)(ns / 1000);
+}
+
+int Timer::read_ms() {
+  return read_us() / 1000;
+}
+
+float Timer::read() {
+  return read_us() / 1e6f;
+}
+
+Timeout::Timeout() : _handler(NULL), _retired(NULL), _armed(false), _due(0), _next(_list) {
+  _list = this;
+}
+
+Timeout::~Timeout() {
+  for (Timeout **t = &_list; *t != NULL; t = &(*t)->_next) {
+    if (*t == this) {
+      *t = _next;
+      break;
+    }
+  }
+  delete _handler;
+  delete _retired;
+}
+
+// A handler may attach itself again while it runs, so the one it replaces is kept until the next attach
+void Timeout::_arm(SimCallback *handler, unsigned int us) {
+  delete _retired;
+  _retired = _handler;
+  _handler = handler;
+  _due = simTime + ((unsigned long long)us * 1000);
+  _armed = true;
+}
+
+void Timeout::detach() {
+  _armed = false;
+}
+
+// Handlers do not nest, and wait while interrupts are masked
+void Timeout::fire(unsigned long long until) {
+
+  while (!simIrqMasked && !simInHandler) {
+    Timeout *next = NULL;
+    for (Timeout *t = _list; t != NULL; t = t->_next) {
+      if (t->_armed && (t->_due <= until) && ((next == NULL) || (t->_due < next->_due))) {
+        next = t;
+      }
+    }
+    if (next == NULL) {
+      return;
+    }
+
+    if (simTime < next->_due) {
+      simTime = next->_due;
+    }
+    next->_armed = false;
+    simInHandler = true;
+    next->_handler->call();
+    simInHandler = false;
+  }
+}
+
+//--------- End virtual clock -----------
+
+
+
+//--------- Start Stream and I2C -----------
+
+int Stream::puts(const char *s) {
+  while (*s) {
+    _putc(*s++);
+  }
+  return 0;
+}
+
+int Stream::printf(const char *format, ...) {
+  char text[256];
+  va_list args;
+
+  va_start(args, format);
+  int count = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+
+  if (count > (int)sizeof(text) - 1) {
+    count = sizeof(text) - 1;
+  }
+  for (int i = 0; i < count; i++) {
+    _putc(text[i]);
+  }
+  return count;
+}
+
+I2C::I2C(PinName sda, PinName scl) : _hz(100000) {
+  (void)sda;
+  (void)scl;
+}
+
+void I2C::frequency(int hz) {
+  _hz = hz;
+}
+
+// The portexpander outputs a value after the acknowledge of its byte
+int I2C::write(int address, const char *data, int length, bool repeated) {
+  unsigned long long bitNs = 1000000000ULL / _hz;
+  unsigned long long start = simTime;
+  TextLCDModel *model = TextLCDModel::find(address);
+
+  (void)repeated;
+
+  // Start condition and address byte
+  simAdvanceNs(bitNs * 10);
+  if (model == NULL) {
+    simAdvanceNs(bitNs);
+    return 1;
+  }
+
+  for (int i = 0; i < length; i++) {
+    simAdvanceNs(bitNs * 9);
+    model->write(data[i] & 0xFF, simTime);
+  }
+
+  // Stop condition
+  simAdvanceNs(bitNs);
+  model->transfer(simTime - start, length);
+  return 0;
+}
+
+// The portexpander samples its pins at the start of each byte
+int I2C::read(int address, char *data, int length, bool repeated) {
+  unsigned long long bitNs = 1000000000ULL / _hz;
+  unsigned long long start = simTime;
+  TextLCDModel *model = TextLCDModel::find(address);
+
+  (void)repeated;
+
+  simAdvanceNs(bitNs * 10);
+  if (model == NULL) {
+    simAdvanceNs(bitNs);
+    return 1;
+  }
+
+  for (int i = 0; i < length; i++) {
+    data[i] = model->read(simTime);
+    simAdvanceNs(bitNs * 9);
+  }
+
+  simAdvanceNs(bitNs);
+  model->transfer(simTime - start, length);
+  return 0;
+}
+
+//--------- End Stream and I2C -----------
+
+
+
+//--------- Start HD44780Model -----------
+
+HD44780Model::HD44780Model() {
+  powerOn(0);
+}
+
+void HD44780Model::powerOn(unsigned long long now) {
+  // The internal reset clears the display
+  memset(_ddram, ' ', sizeof(_ddram));
+  memset(_cgram, 0, sizeof(_cgram));
+  _ac = 0;
+  _cgSelected = false;
+  _increment = true;
+  _twoLine = false;
+  _display = false;
+  _eightBit = true;
+  _initCount = 0;
+  _lowNibble = false;
+  _high = 0;
+  _readValue = 0;
+  _drive = -1;
+  _busyUntil = now + SIM_LCD_POWERUP_NS;
+  _powerUpUntil = _busyUntil;
+}
+
+// With RW high the controller puts the next nibble of the Busy flag/address counter
+// (RS low) or of the RAM data (RS high) on D7..D4
+void HD44780Model::risingEdge(bool rs, bool rw, unsigned long long now) {
+
+  if (!rw) {
+    _drive = -1;
+    return;
+  }
+
+  if (!_lowNibble) {
+    if (rs) {
+      _readValue = _cgSelected ? _cgram[_ac & 0x3F] : _ddram[_ac & 0x7F];
+    }
+    else {
+      _readValue = (busy(now) ? 0x80 : 0x00) | (_ac & 0x7F);
+    }
+  }
+  _drive = _lowNibble ? (_readValue & 0x0F) : (_readValue >> 4);
+}
+
+// The controller latches the nibble on D7..D4 when E goes low
+bool HD44780Model::fallingEdge(bool rs, bool rw, int nibble, unsigned long long now, TextLCDBusStats *stats) {
+  bool violation = false;
+
+  _drive = -1;
+
+  if (rw) {
+    if (_eightBit || _lowNibble) {
+      stats->reads++;
+      if (rs) {
+        _step();
+      }
+    }
+    if (!_eightBit) {
+      _lowNibble = !_lowNibble;
+    }
+    return false;
+  }
+
+  // Nothing may be written until the last instruction has been executed
+  if (!_lowNibble) {
+    violation = busy(now);
+  }
+
+  if (_eightBit) {
+    // D3..D0 are not connected in 4-bit use and read as 0
+    _execute(rs, nibble << 4, now, stats);
+  }
+  else if (!_lowNibble) {
+    _high = nibble;
+    _lowNibble = true;
+  }
+  else {
+    _lowNibble = false;
+    _execute(rs, (_high << 4) | nibble, now, stats);
+  }
+
+  return violation;
+}
+
+void HD44780Model::_execute(bool rs, int value, unsigned long long now, TextLCDBusStats *stats) {
+
+  if (rs) {
+    if (_cgSelected) {
+      _cgram[_ac & 0x3F] = value & 0x1F;
+    }
+    else {
+      _ddram[_ac & 0x7F] = value;
+    }
+    _step();
+    _busyUntil = now + SIM_LCD_EXEC_NS;
+    stats->data++;
+  }
+  else {
+    _instruction(value, now);
+    stats->commands++;
+  }
+}
+
+void HD44780Model::_instruction(int value, unsigned long long now) {
+  unsigned long long exec = SIM_LCD_EXEC_NS;
+
+  if (value & 0x80) {
+    // Set DD-RAM address
+    _ac = value & 0x7F;
+    _cgSelected = false;
+  }
+  else if (value & 0x40) {
+    // Set CG-RAM address
+    _ac = value & 0x3F;
+    _cgSelected = true;
+  }
+  else if (value & 0x20) {
+    // Function set, the first ones of the bootprocess take longer
+    if (_eightBit) {
+      if (_initCount == 0) {
+        exec = SIM_LCD_INIT1_NS;
+      }
+      else if (_initCount == 1) {
+        exec = SIM_LCD_INIT2_NS;
+      }
+      _initCount++;
+    }
+    _eightBit = (value & 0x10) != 0;
+    _twoLine = (value & 0x08) != 0;
+    _lowNibble = false;
+  }
+  else if (value & 0x10) {
+    // Cursor or display shift, only the cursor move changes the contents seen
+    if (!(value & 0x08)) {
+      bool increment = _increment;
+      _increment = (value & 0x04) != 0;
+      _step();
+      _increment = increment;
+    }
+  }
+  else if (value & 0x08) {
+    // Display on/off control
+    _display = (value & 0x04) != 0;
+  }
+  else if (value & 0x04) {
+    // Entry mode set
+    _increment = (value & 0x02) != 0;
+  }
+  else if (value & 0x02) {
+    // Return home
+    _ac = 0;
+    _cgSelected = false;
+    exec = SIM_LCD_HOME_NS;
+  }
+  else if (value & 0x01) {
+    // Clear display
+    memset(_ddram, ' ', sizeof(_ddram));
+    _ac = 0;
+    _cgSelected = false;
+    _increment = true;
+    exec = SIM_LCD_HOME_NS;
+  }
+
+  _busyUntil = now + exec;
+}
+
+// Move the address counter on after a RAM access
+// Two-line DD-RAM is 0x00-0x27 and 0x40-0x67, one-line DD-RAM is 0x00-0x4F
+void HD44780Model::_step() {
+
+  if (_cgSelected) {
+    _ac = (_ac + (_increment ? 1 : -1)) & 0x3F;
+  }
+  else if (_twoLine) {
+    if (_increment) {
+      _ac = (_ac == 0x27) ? 0x40 : ((_ac == 0x67) ? 0x00 : _ac + 1);
+    }
+    else {
+      _ac = (_ac == 0x40) ? 0x27 : ((_ac == 0x00) ? 0x67 : _ac - 1);
+    }
+  }
+  else {
+    if (_increment) {
+      _ac = (_ac == 0x4F) ? 0x00 : _ac + 1;
+    }
+    else {
+      _ac = (_ac == 0x00) ? 0x4F : _ac - 1;
+    }
+  }
+}
+
+//--------- End HD44780Model -----------
+
+
+
+//--------- Start TextLCDModel -----------
+
+TextLCDModel::TextLCDModel(int address, int columns, int rows) :
+    _address(address & 0xFE), _columns(columns), _rows(rows), _port(0xFF), _verbose(false) {
+
+  _controllers = ((columns == 40) && (rows == 4)) ? 2 : 1;
+  _rwConnected = (_controllers == 1);
+  _ctrl[0].powerOn(simTime);
+  _ctrl[1].powerOn(simTime);
+  clearStats();
+
+  for (int i = 0; i < SIM_LCD_MAX_MODELS; i++) {
+    if (_models[i] == NULL) {
+      _models[i] = this;
+      break;
+    }
+  }
+}
+
+TextLCDModel::~TextLCDModel() {
+  for (int i = 0; i < SIM_LCD_MAX_MODELS; i++) {
+    if (_models[i] == this) {
+      _models[i] = NULL;
+    }
+  }
+}
+
+TextLCDModel *TextLCDModel::find(int address) {
+  for (int i = 0; i < SIM_LCD_MAX_MODELS; i++) {
+    if ((_models[i] != NULL) && (_models[i]->_address == (address & 0xFE))) {
+      return _models[i];
+    }
+  }
+  return NULL;
+}
+
+void TextLCDModel::clearStats() {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void TextLCDModel::transfer(unsigned long long busNs, int bytes) {
+  _stats.transactions++;
+  _stats.bytes += bytes;
+  _stats.busNs += busNs;
+}
+
+// Rows 0 and 1 start at 0x00 and 0x40, rows 2 and 3 follow them on after the columns
+// On LCD40x4 rows 2 and 3 are rows 0 and 1 of the second controller
+unsigned char TextLCDModel::at(int column, int row) const {
+  int ctrl = 0;
+
+  if ((_controllers == 2) && (row >= 2)) {
+    ctrl = 1;
+    row -= 2;
+  }
+  return _ctrl[ctrl].ddram(((row & 1) ? 0x40 : 0x00) + ((row / 2) * _columns) + column);
+}
+
+void TextLCDModel::row(int row, char *text) const {
+
+  for (int column = 0; column < _columns; column++) {
+    unsigned char c = at(column, row);
+    if (c < 8) {
+      text[column] = '0' + c;
+    }
+    else if ((c < ' ') || (c > '~')) {
+      text[column] = '?';
+    }
+    else {
+      text[column] = c;
+    }
+  }
+  text[_columns] = '\0';
+}
+
+void TextLCDModel::print(FILE *out) const {
+  char text[41];
+
+  for (int r = 0; r < _rows; r++) {
+    row(r, text);
+    fprintf(out, "|%s|\n", text);
+  }
+}
+
+void TextLCDModel::_violation(const char *what, unsigned long long now) {
+  _stats.violations++;
+  if (_verbose) {
+    fprintf(stderr, "TextLCDModel 0x%02X at %llu us: %s\n", _address, now / 1000, what);
+  }
+}
+
+// E (and E2 on LCD40x4) edges drive the controllers, D7..D4 carry the nibbles
+void TextLCDModel::write(int value, unsigned long long now) {
+  int previous = _port;
+  bool rs = (value & D_LCD_RS) != 0;
+  bool rw = _rwConnected && ((value & D_LCD_RW) != 0);
+  bool wasRs = (previous & D_LCD_RS) != 0;
+  bool wasRw = _rwConnected && ((previous & D_LCD_RW) != 0);
+  int nibble = ((value & D_LCD_D4) ? 0x01 : 0) | ((value & D_LCD_D5) ? 0x02 : 0) |
+               ((value & D_LCD_D6) ? 0x04 : 0) | ((value & D_LCD_D7) ? 0x08 : 0);
+
+  _port = value;
+
+  for (int i = 0; i < _controllers; i++) {
+    int enable = (i == 0) ? D_LCD_E : D_LCD_E2;
+    bool was = (previous & enable) != 0;
+    bool is = (value & enable) != 0;
+
+    if (!was && is) {
+      _ctrl[i].risingEdge(rs, rw, now);
+    }
+    else if (was && is) {
+      if (((rs != wasRs) || (rw != wasRw)) && !_ctrl[i].poweringUp(now)) {
+        _violation("RS or RW changed while E high", now);
+      }
+    }
+    else if (was && !is) {
+      // The portexpander comes up with all pins high, so E is high until the first write
+      if (((rs != wasRs) || (rw != wasRw)) && !_ctrl[i].poweringUp(now)) {
+        _violation("RS or RW changed with E going low", now);
+      }
+      if (_ctrl[i].fallingEdge(wasRs, wasRw, nibble, now, &_stats)) {
+        _violation(wasRs ? "data written while busy" : "instruction written while busy", now);
+      }
+    }
+  }
+}
+
+// Pins are quasi-bidirectional, a pin written high reads low when the controller pulls it low
+int TextLCDModel::read(unsigned long long now) {
+  int value = _port;
+
+  (void)now;
+  for (int i = 0; i < _controllers; i++) {
+    int drive = _ctrl[i].drive();
+    if (drive >= 0) {
+      if (!(drive & 0x01)) value &= ~D_LCD_D4;
+      if (!(drive & 0x02)) value &= ~D_LCD_D5;
+      if (!(drive & 0x04)) value &= ~D_LCD_D6;
+      if (!(drive & 0x08)) value &= ~D_LCD_D7;
+    }
+  }
+  return value;
+}
+
+//--------- End TextLCDModel -----------
+
+#endif
@@ -0,0 +1,161 @@
+/* TextLCDModel. A host side model of a PCF8574 I2C portexpander with one or two
+ * HD44780 controllers behind it, wired the way TextLCD_I2C expects (D_LCD_PIN_* in TextLCD.h).
+ *
+ * The controllers follow the portexpander pins value by value: E going low latches a nibble,
+ * the 4-bit interface pairs them up, and instructions and data end up in DD-RAM and CG-RAM.
+ * With RW high the controller drives D7..D4 so the Busy flag and address counter can be read.
+ * Each instruction keeps the controller busy for its datasheet execution time, an instruction
+ * sent while busy is counted as a violation (and still executed, so the contents show what was sent).
+ *
+ * Bus stats count the I2C transfers, portexpander values and bus time, clearStats() at the
+ * start of a frame and stats() after it to see what the frame cost.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MBED_TEXTLCD_MODEL_H
+#define MBED_TEXTLCD_MODEL_H
+
+#include "mbed.h"
+#include "TextLCD.h"
+
+//HD44780 timing in ns, datasheet values at 270kHz
+#define SIM_LCD_POWERUP_NS   15000000    // Vcc up to the first instruction
+#define SIM_LCD_EXEC_NS         37000    // most instructions and data writes
+#define SIM_LCD_HOME_NS       1520000    // Clear display and Return home
+#define SIM_LCD_INIT1_NS      4100000    // first 8-bit Function set of the 4-bit bootprocess
+#define SIM_LCD_INIT2_NS       100000    // second one
+
+//Portexpanders that can be on the sim I2C bus at once
+#define SIM_LCD_MAX_MODELS   4
+
+
+// Bus activity counters
+struct TextLCDBusStats {
+  int transactions;              // I2C transfers to the portexpander
+  int bytes;                     // portexpander values written and read
+  unsigned long long busNs;      // time the transfers held the I2C bus
+  int commands;                  // instructions executed
+  int data;                      // data bytes written to DD-RAM or CG-RAM
+  int reads;                     // Busy flag/address counter and data reads
+  int violations;                // instructions while busy, RS/RW changed while E high
+};
+
+
+// One HD44780 controller, the 4-bit interface side of it
+class HD44780Model {
+public:
+  HD44780Model();
+
+  // Power on, the controller is in 8-bit mode and busy for SIM_LCD_POWERUP_NS
+  void powerOn(unsigned long long now);
+
+  // E going high and low, the other lines as they are on the portexpander
+  // fallingEdge() returns true when a write came while the controller was busy
+  void risingEdge(bool rs, bool rw, unsigned long long now);
+  bool fallingEdge(bool rs, bool rw, int nibble, unsigned long long now, TextLCDBusStats *stats);
+
+  // D7..D4 as driven by the controller while E and RW are high, -1 when not driving
+  int drive() const { return _drive; }
+
+  // Contents
+  unsigned char ddram(int addr) const { return _ddram[addr & 0x7F]; }
+  const unsigned char *cgram(int udc) const { return &_cgram[(udc & 0x07) << 3]; }
+  int address() const { return _ac; }
+  bool fourBit() const { return !_eightBit; }
+  bool displayOn() const { return _display; }
+  bool busy(unsigned long long now) const { return now < _busyUntil; }
+  bool poweringUp(unsigned long long now) const { return now < _powerUpUntil; }
+
+private:
+  unsigned char _ddram[128];
+  unsigned char _cgram[64];
+  int _ac;                       // address counter
+  bool _cgSelected;              // data goes to CG-RAM
+  bool _increment;
+  bool _twoLine;
+  bool _display;
+  bool _eightBit;
+  int _initCount;                // 8-bit Function sets seen, for their longer execution times
+  bool _lowNibble;               // the next nibble is the low half of a byte
+  int _high;                     // the high half
+  int _readValue;                // Busy flag/address counter or RAM data being read
+  int _drive;
+  unsigned long long _busyUntil;
+  unsigned long long _powerUpUntil;
+
+  void _execute(bool rs, int value, unsigned long long now, TextLCDBusStats *stats);
+  void _instruction(int value, unsigned long long now);
+  void _step();
+};
+
+
+// PCF8574 with the controller(s) behind it
+class TextLCDModel {
+public:
+  // address is the 8-bit slave address, as passed to TextLCD_I2C
+  // A 40x4 panel gets a second controller on E2, RW is then not connected
+  TextLCDModel(int address = 0x40, int columns = 20, int rows = 4);
+  ~TextLCDModel();
+
+  // Contents of the panel, character codes as in DD-RAM (UDCs are 0..7)
+  int columns() const { return _columns; }
+  int rows() const { return _rows; }
+  unsigned char at(int column, int row) const;
+  const unsigned char *cgram(int udc, int ctrl = 0) const { return _ctrl[ctrl].cgram(udc); }
+  const HD44780Model& controller(int ctrl = 0) const { return _ctrl[ctrl]; }
+  bool backlight() const { return (_port & D_LCD_BL) != 0; }
+
+  // Text of one row, UDCs shown as '0'..'7' and other codes outside ASCII as '?'
+  void row(int row, char *text) const;
+  void print(FILE *out = stdout) const;
+
+  // Report each violation on stderr
+  void setVerbose(bool verbose) { _verbose = verbose; }
+
+  // With RW not connected the controller sees every access as a write, so the Busy flag reads stuck
+  // and a read of it executes as an instruction (RW is never connected on a 40x4 panel)
+  void setRWConnected(bool connected) { _rwConnected = connected && (_controllers == 1); }
+
+  const TextLCDBusStats& stats() const { return _stats; }
+  void clearStats();
+
+  // Bus side, called by the sim I2C
+  static TextLCDModel *find(int address);
+  void transfer(unsigned long long busNs, int bytes);
+  void write(int value, unsigned long long now);
+  int read(unsigned long long now);
+
+private:
+  int _address;
+  int _columns;
+  int _rows;
+  int _controllers;
+  bool _rwConnected;
+  HD44780Model _ctrl[2];
+  int _port;                     // last value written to the portexpander
+  bool _verbose;
+  TextLCDBusStats _stats;
+
+  void _violation(const char *what, unsigned long long now);
+
+  static TextLCDModel *_models[SIM_LCD_MAX_MODELS];
+};
+
+#endif
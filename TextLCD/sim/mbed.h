@@ -0,0 +1,195 @@
+/* Host stand-in for the small part of mbed used by the TextLCD library, so the
+ * library builds on a PC and talks to TextLCDModel instead of the PCF8574 on p28/p27.
+ * Only put this directory on the include path of host builds:
+ *
+ *   g++ -DTEXTLCD_HOST_SIM -ITextLCD/sim -ITextLCD TextLCD/TextLCD.cpp TextLCD/sim/TextLCDModel.cpp ...
+ *
+ * Time is virtual. wait()/wait_ms()/wait_us() move the clock on, and so does every I2C transfer,
+ * by the time its bits take at the bus frequency. Timeout handlers run when the clock passes their
+ * time and interrupts are enabled, the way the Timer interrupt would break into the main program.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEXTLCD_SIM_MBED_H
+#define TEXTLCD_SIM_MBED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// The mbed pin names, only used to construct the interfaces
+typedef enum {
+    p5 = 5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18, p19, p20,
+    p21, p22, p23, p24, p25, p26, p27, p28, p29, p30,
+    USBTX, USBRX,
+    NC = -1
+} PinName;
+
+// Virtual clock
+unsigned long long simNowNs();
+void simAdvanceNs(unsigned long long ns);
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+// Interrupts masked by __disable_irq() hold Timeout handlers back until __enable_irq()
+void __disable_irq();
+void __enable_irq();
+
+
+class Timer {
+public:
+    Timer();
+
+    void start();
+    void stop();
+    void reset();
+    int read_us();
+    int read_ms();
+    float read();
+
+private:
+    bool _running;
+    unsigned long long _start;
+    unsigned long long _elapsed;
+};
+
+
+// Handler called by a Timeout
+class SimCallback {
+public:
+    virtual ~SimCallback() {}
+    virtual void call() = 0;
+};
+
+template<class T>
+class SimMemberCallback : public SimCallback {
+public:
+    SimMemberCallback(T *object, void (T::*member)()) : _object(object), _member(member) {}
+    virtual void call() { (_object->*_member)(); }
+
+private:
+    T *_object;
+    void (T::*_member)();
+};
+
+class Timeout {
+public:
+    Timeout();
+    ~Timeout();
+
+    template<class T>
+    void attach_us(T *object, void (T::*member)(), unsigned int us) {
+      _arm(new SimMemberCallback<T>(object, member), us);
+    }
+
+    template<class T>
+    void attach(T *object, void (T::*member)(), float s) {
+      _arm(new SimMemberCallback<T>(object, member), (unsigned int)(s * 1e6f));
+    }
+
+    void detach();
+
+    // Run the handlers that fall due until then, as the clock moves on
+    static void fire(unsigned long long until);
+
+private:
+    SimCallback *_handler;
+    SimCallback *_retired;     // replaced while it ran, deleted on the next attach
+    bool _armed;
+    unsigned long long _due;
+    Timeout *_next;
+
+    void _arm(SimCallback *handler, unsigned int us);
+
+    static Timeout *_list;
+};
+
+
+class Stream {
+public:
+    Stream(const char *name = NULL) { (void)name; }
+    virtual ~Stream() {}
+
+    int putc(int c) { return _putc(c); }
+    int getc() { return _getc(); }
+    int puts(const char *s);
+    int printf(const char *format, ...);
+
+protected:
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+};
+
+
+// The parallel and SPI interfaces have nothing behind them
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : _value(0) { (void)pin; }
+    void write(int value) { _value = value; }
+    int read() { return _value; }
+    DigitalOut& operator= (int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    int _value;
+};
+
+class BusOut {
+public:
+    BusOut(PinName p0, PinName p1 = NC, PinName p2 = NC, PinName p3 = NC) : _value(0) { (void)p0; (void)p1; (void)p2; (void)p3; }
+    void write(int value) { _value = value; }
+    int read() { return _value; }
+    BusOut& operator= (int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    int _value;
+};
+
+class SPI {
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk) { (void)mosi; (void)miso; (void)sclk; }
+    void format(int bits, int mode = 0) { (void)bits; (void)mode; }
+    void frequency(int hz = 1000000) { (void)hz; }
+    int write(int value) { (void)value; return 0xFF; }
+};
+
+
+// A transfer to the address of a TextLCDModel goes to that model, any other address is not acknowledged.
+// Each transfer takes its start, address byte, data bytes and stop at the bus frequency (100kHz by default).
+class I2C {
+public:
+    I2C(PinName sda, PinName scl);
+
+    void frequency(int hz);
+
+    // Return 0 on success (ack), non-0 on failure (nack)
+    int write(int address, const char *data, int length, bool repeated = false);
+    int read(int address, char *data, int length, bool repeated = false);
+
+private:
+    int _hz;
+};
+
+#endif
@@ -10,13 +10,14 @@
 #include "OneWire/DS18B20.h"
 #include "OneWire/OneWireDefs.h"
 #include "common.h"
+#include "lcdformat.h"
 
 
 void masterAlarm(TextLCD_I2C &lcd,int holdBack ,bool *flag){
 
 	if(*flag==false) lcd.cls();
     lcd.setAddress(4,1);
-    lcd.printf("MASTER ALARM");
+    lcdPrint(&lcd,"MASTER ALARM");
     Buzz.beep(1000,0.5);
     *flag=true;
 
@@ -15,7 +15,7 @@ extern Beep Buzz;
 extern Serial PC;
 extern GPS gps;
 extern I2C i2c_lcd;
-extern TextLCD_I2C lcd;
+extern TextLCD_I2C_T<TextLCD::LCD20x4> lcd;
 extern DS18B20 WaterTemp;
 
 
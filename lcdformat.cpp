@@ -0,0 +1,150 @@
+//
+//  lcdformat.cpp
+//  Mbed JEEP
+//
+//  Created by fmonpelat on 18/10/26.
+//  Copyright (c) 2026 ___FMONPELAT___. All rights reserved.
+//
+#include "mbed.h"
+#include "TextLCD.h"
+#include "lcdformat.h"
+
+
+// value is in units of 10^-decimals, right aligned to width, e.g.
+// formatFixed(text, -53, 1, 5, 0) -> " -5.3". A value that doesn't fit is
+// shown as width '#', so it never runs into the next field; width 0 takes
+// as many characters as the value needs. text holds FORMAT_TEXT_SIZE.
+char *formatFixed(char *text,long value,int decimals,int width,int flags){
+
+	char digits[12];
+	unsigned long magnitude;
+	char sign=0;
+	int n=0,length;
+	char *p=text;
+
+	if(decimals<0) decimals=0;
+	if(decimals>9) decimals=9;
+	if(width>FORMAT_TEXT_SIZE-1) width=FORMAT_TEXT_SIZE-1;
+
+	length=formatLength(value,decimals,flags);
+	if(width>0 && length>width)
+	{
+		memset(text,FORMAT_OVERFLOW,width);
+		text[width]='\0';
+		return text;
+	}
+
+	if(value<0){
+		sign='-';
+		magnitude=-(unsigned long)value;
+	}
+	else{
+		if(flags & FORMAT_PLUS) sign='+';
+		magnitude=value;
+	}
+
+	// least significant first, with at least one digit in front of the point
+	do{
+		digits[n++]='0' + magnitude%10;
+		magnitude/=10;
+	}while(magnitude || n<=decimals);
+
+	if(!(flags & FORMAT_ZEROS))
+	{
+		for(;length<width;length++) *p++=' ';
+	}
+	if(sign) *p++=sign;
+	for(;length<width;length++) *p++='0';
+	while(n)
+	{
+		*p++=digits[--n];
+		if(n==decimals && n) *p++='.';
+	}
+	if(flags & FORMAT_DEGREE) *p++=(char)LCD_DEGREE;
+	*p='\0';
+
+	return text;
+}
+
+// characters formatFixed() needs for value without padding
+int formatLength(long value,int decimals,int flags){
+
+	unsigned long magnitude=(value<0) ? -(unsigned long)value : value;
+	int n=0;
+
+	if(decimals<0) decimals=0;
+	if(decimals>9) decimals=9;
+
+	do{
+		n++;
+		magnitude/=10;
+	}while(magnitude || n<=decimals);
+
+	return n + ((value<0 || (flags & FORMAT_PLUS)) ? 1 : 0) + (decimals ? 1 : 0) + ((flags & FORMAT_DEGREE) ? 1 : 0);
+}
+
+char *formatInt(char *text,long value,int width,int flags){
+
+	return formatFixed(text,value,0,width,flags);
+}
+
+// "hh:mm:ss"
+char *formatTime(char *text,int hour,int minute,int second){
+
+	formatFixed(text,hour,0,2,FORMAT_ZEROS);
+	text[2]=':';
+	formatFixed(text+3,minute,0,2,FORMAT_ZEROS);
+	text[5]=':';
+	formatFixed(text+6,second,0,2,FORMAT_ZEROS);
+
+	return text;
+}
+
+// "dd/mm/yyyy"
+char *formatDate(char *text,int day,int month,int year){
+
+	formatFixed(text,day,0,2,FORMAT_ZEROS);
+	text[2]='/';
+	formatFixed(text+3,month,0,2,FORMAT_ZEROS);
+	text[5]='/';
+	formatFixed(text+6,year,0,4,FORMAT_ZEROS);
+
+	return text;
+}
+
+// value in 1/100000 degree, negative south or west, shown as degrees and
+// minutes to 1/1000: "34*36.123S" or "058*22.500W", * being the degree sign
+char *formatCoord(char *text,long value,bool latitude){
+
+	char hemisphere;
+	long degrees,minutes;
+	char *p;
+
+	if(value<0){
+		hemisphere=latitude ? 'S' : 'W';
+		value=-value;
+	}
+	else{
+		hemisphere=latitude ? 'N' : 'E';
+	}
+	degrees=value/100000;
+	minutes=((value%100000)*3 + 2)/5;	// 1/100000 deg -> 1/1000 min, rounded
+	if(minutes>=60000){
+		degrees++;
+		minutes-=60000;
+	}
+
+	p=text + (latitude ? 3 : 4);			// the degrees and their sign
+	formatFixed(text,degrees,0,p-text,FORMAT_ZEROS | FORMAT_DEGREE);
+	formatFixed(p,minutes,3,6,FORMAT_ZEROS);
+	p[6]=hemisphere;
+	p[7]='\0';
+
+	return text;
+}
+
+// straight to the display, without going through the Stream printf
+void lcdPrint(TextLCD_Base *lcd,const char *text){
+
+	while(*text) lcd->putc(*text++);
+}
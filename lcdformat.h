@@ -0,0 +1,40 @@
+/*
+ * lcdformat.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: fmonpelat
+ */
+
+#ifndef LCDFORMAT_H_
+#define LCDFORMAT_H_
+
+#include "TextLCD.h"
+
+// Text for the LCD without printf. Every number is an integer in fixed
+// point: formatFixed(text, 1825, 2, ...) shows "18.25". One function per
+// kind of text, so the compiler checks what is passed where a printf
+// format string couldn't be, and nothing pulls vfprintf or soft float
+// formatting in. The text goes to a buffer of the caller, the functions
+// return it so they can be passed straight to lcdPrint().
+
+#define FORMAT_TEXT_SIZE 21		// one LCD row plus the terminator, enough for any format
+#define LCD_DEGREE 223			// degree sign in the HD44780 A00 character ROM
+
+// flags for formatFixed() and formatInt()
+#define FORMAT_ZEROS	0x01	// pad with '0' after the sign instead of ' ' in front
+#define FORMAT_PLUS		0x02	// '+' in front of positive values
+#define FORMAT_DEGREE	0x04	// degree sign after the number, counted in the width
+
+#define FORMAT_OVERFLOW '#'		// fills the width when the value doesn't fit
+
+//Prototypes
+
+char *formatFixed(char *,long ,int ,int ,int);
+int formatLength(long ,int ,int);
+char *formatInt(char *,long ,int ,int);
+char *formatTime(char *,int ,int ,int);
+char *formatDate(char *,int ,int ,int);
+char *formatCoord(char *,long ,bool);
+void lcdPrint(TextLCD_Base *,const char *);
+
+#endif /* LCDFORMAT_H_ */
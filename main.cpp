@@ -10,6 +10,8 @@
 #include "TextLCD.h"
 #include "OneWire/DS18B20.h"
 #include "OneWire/OneWireDefs.h"
+#include "OneWire/DebugTrace.h"
+#include "OneWire/OneWireHotPlug.h"
 #include "MODGPS/GPS.h"
 #include "keypad/Keypad.h"
 #include "beep/beep.h"
@@ -17,6 +19,10 @@
 #include "alarms.h"
 #include "common.h"
 #include "menu.h"
+#include "sampling.h"
+#include "tempstats.h"
+#include "widgets.h"
+#include "lcdformat.h"
 
 #define PCBAUD 9600
 #define GPSRX p14
@@ -24,6 +30,11 @@
 #define THERMOMETER DS18B20
 #define JEEP_INTRO 5
 #define GPS_FIX 2
+#define WATER_TEMP_MAX 100
+#define HOTPLUG_INTERVAL 500
+#define WATER_GAUGE_MIN 40
+#define SPEED_GAUGE_MAX 120
+#define TREND_LIMIT (99*16)		// 1/16 deg C per minute, the most the stats screen shows
 
 DigitalOut myled(LED1);
 
@@ -38,11 +49,34 @@ GPS gps(NC, p14);
 
 // I2C Communication LCD - 20x4
 I2C i2c_lcd(p28,p27); // SDA, SCL
-TextLCD_I2C lcd(&i2c_lcd, 0x4E, TextLCD::LCD20x4);   // I2C bus, PCF8574 Slaveaddress, LCD Type
+TextLCD_I2C_T<TextLCD::LCD20x4> lcd(&i2c_lcd, 0x4E);   // I2C bus, PCF8574 Slaveaddress, LCD Type fixed at compile time
 
 // Temperature Controller Initialization.
 //device( crcOn, useAddress, parasitic, mbed pin );
 THERMOMETER WaterTemp(true, true, false, p25);
+tempSampler WaterSampler;
+OneWireHotPlug WaterProbes(WaterTemp.bus(), DS18B20_ID);
+tempStats WaterStats;
+
+// Uptime in ms, accumulated so it doesn't wrap with the Timer's us counter
+Timer uptime;
+int uptimeMs=0;
+int uptimeUs=0;
+
+// GPS screen fields, redrawn only when their value changes
+enum { GPS_HOUR, GPS_MINUTE, GPS_SECOND, GPS_DAY, GPS_MONTH, GPS_YEAR, GPS_SATS, GPS_SPEED, GPS_COURSE, GPS_FIELDS };
+lcdField gpsFields[GPS_FIELDS];
+
+// driving screen, water temperature and speed as live gauges
+lcdField waterField;
+lcdField speedField;
+lcdBar waterBar;
+lcdBar speedBar;
+lcdSpark waterSpark;
+
+// every menu has its own screen in the lcd, the ones not on display are kept up to date
+// in their framebuffers and a key press only sends what differs from the one shown
+enum { SCREEN_HOME, SCREEN_GPS, SCREEN_NAVIGATION, SCREEN_TEMP, SCREEN_DRIVING };
 
 // KEYPAD DEFS
 char Keytable[] = {
@@ -63,8 +97,17 @@ Keypad keypad( p6 , p7,  p8,  p9,  p5,  NC,  NC,  NC,30);
 //######## Prototypes ############
 void printIntro(void);
 void ScreenLoadinggps(void);
+void ScreenGpsInit(void);
+void ScreenGpsLabels(void);
+void ScreenGps(GPS_Time *,GPS_VTG *);
+void ScreenDrivingInit(void);
+void ScreenDrivingLabels(void);
+void ScreenDriving(GPS_VTG *);
+void ScreenTempStats(void);
+void printStatsRow(const char *label, const statsBucket *b);
 uint32_t commandAfterInput(uint32_t index);
 void init(void);
+int readUptimeMs(void);
 
 int main() {
     
@@ -72,16 +115,14 @@ int main() {
     bool masterflag=false;
     int i=3;
     uint32_t row,col;
+    int block;
     bool gpsFixflag=true;
     bool firstExecflag=true;
     bool keypadFlagA=false;
     bool keypadFlagB=false;
     bool keypadFlagC=false;
     bool keypadFlagD=false;
-    bool firstPressedA=true;
-    bool firstPressedB=true;
-    bool firstPressedC=true;
-    bool firstPressedD=true;
+    bool gpsRedraw=true;
 
     // GPS VARIABLES
     uint32_t quality;
@@ -89,40 +130,102 @@ int main() {
     GPS_Time GpsTime;
     GPS_VTG GpsVector;
     double localHour;
+
+    // uptime in ms at the top of the loop
+    int now;
+    int lastHotPlugMs=0;
+    BYTE probeRom[ADDRESS_SIZE];
     
     keypad.attach(&commandAfterInput);
     keypad.start();
+
+    uptime.start();
+    samplerInit(&WaterSampler, &WaterTemp, WATER_TEMP_MAX*16);
+    ScreenGpsInit();
+    ScreenDrivingInit();
+    statsInit(&WaterStats, WATER_TEMP_MAX*16);
+
+    // screens are drawn into the lcd framebuffer, flush() sends what changed
+    lcd.setRefresh(TextLCD::RefreshBuffered);
+    // and the changes are sent from a timer interrupt, the loop doesn't wait for the i2c bus
+    lcd.setTransfer(TextLCD::TransferQueued);
     
-    lcd.setUDC(0, (char *) udc_bar_6);
+    block=lcd.glyph(udc_bar_6);
     for(row=0;row<4;row++)
     {
     	for(col=0;col<20;col++)
     	{
-    	lcd.putc(0);
+    	lcd.putc(block);
     	}
 
     }
+    lcd.flush();
     // init displays the logo.
     init();
 
     // we erase screen just in case.
     lcd.cls();
 
+    // the text that never changes is drawn once
+    lcd.setScreen(SCREEN_NAVIGATION);
+    lcdPrint(&lcd,"navegation menu");
+    lcd.setScreen(SCREEN_DRIVING);
+    ScreenDrivingLabels();
+
     while(true)
     {
+    	// the queued lcd writes block in its interrupt, keep them off the 1-Wire slots
+    	lcd.pause();
+    	// reads the sensor only when its adaptive interval is due
+    	now=readUptimeMs();
+    	if(samplerPoll(&WaterSampler, now))
+    	{
+    		statsAdd(&WaterStats, WaterSampler.temperature, now);
+    	}
+    	// one hot-plug search step between samples, picks up a swapped probe
+    	if(now-lastHotPlugMs >= HOTPLUG_INTERVAL)
+    	{
+    		lastHotPlugMs=now;
+    		switch(WaterProbes.poll(probeRom))
+    		{
+    			case HOTPLUG_REMOVED:
+    				samplerRescan(&WaterSampler);
+    				break;
+    			case HOTPLUG_ADDED:
+    				// the first pass reports the probe we already have
+    				if(!WaterSampler.valid) samplerRescan(&WaterSampler);
+    				break;
+    			default:
+    				break;
+    		}
+    	}
+    	lcd.resume();
+    	// sensor traces are buffered, write them out away from the bus timing
+    	TRACE_FLUSH();
+    	// 'h' from the PC dumps the 1-Wire health counters
+    	if(PC.readable() && PC.getc()=='h')
+    	{
+    		WaterTemp.printHealth(PC);
+    	}
+
+    	// screens updated in the background, only the cells that change reach the lcd when shown
+    	lcd.setScreen(SCREEN_TEMP);
+    	ScreenTempStats();
+    	lcd.setScreen(SCREEN_DRIVING);
+    	gps.vtg(&GpsVector);
+    	ScreenDriving(&GpsVector);
 
     	switch(Index)
     	{
 
     		//-------------------    GPS DATA -------------------------------
     		case 0:
-    				if(firstPressedA) lcd.cls();
-    				lcd.setAddress(0,0);
+    				lcd.setScreen(SCREEN_GPS);
+    				lcd.showScreen(SCREEN_GPS);
 
 					gps.geodetic(&GpsData);
 					gps.timeNow(&GpsTime);
 					gps.vtg(&GpsVector);
-					lcd.setAddress(0,0);
 					// test gps quality
 					if(!gps.getGPSquality())
 					{
@@ -133,21 +236,20 @@ int main() {
 					{
 						i=0;
 						if(gpsFixflag==false){
-							lcd.cls();
-							lcd.setAddress(0,0);
+							gpsRedraw=true;
 							PC.printf("gpsFixflag is false / cls() / fix=OK\n");
 						}
 						gpsFixflag=true;
 					}
 					if( i<3 )
 					{
-						lcd.setAddress(0,0);
+						if(gpsRedraw)
+						{
+							ScreenGpsLabels();
+							gpsRedraw=false;
+						}
 						localHour=GpsTime.hour-3;
-						lcd.printf("%02d:%02d:%02d %02d/%02d/%04d\n", GpsTime.hour, GpsTime.minute, GpsTime.second, GpsTime.day, GpsTime.month, GpsTime.year);
-						lcd.setAddress(0,1);
-						lcd.printf("Sat:%d",gps.numOfSats());
-						lcd.setAddress(0,2);
-						lcd.printf("Sp:%.1fkn Cp:%.2f", GpsVector._velocity_kph ,GpsVector._track_mag);
+						ScreenGps(&GpsTime,&GpsVector);
 					}
 					else
 					{
@@ -161,8 +263,9 @@ int main() {
 						PC.printf("GPS fix 2sec wait\n");
 						gpsFixflag=false;
 						firstExecflag=false;
+						// the loading screen wrote over the fields
+						gpsRedraw=true;
 					}
-					firstPressedA=false;
 					keypadFlagA=true;
 			    	keypadFlagB=false;
 			    	keypadFlagC=false;
@@ -171,58 +274,53 @@ int main() {
 
 			//---------------------------   NAVEGATION --------------------------
 			case 1:
-					if(firstPressedB) lcd.cls();
-					lcd.setAddress(0,0);
-					lcd.printf("navegation menu");
+					lcd.showScreen(SCREEN_NAVIGATION);
 					keypadFlagA=false;
 					keypadFlagB=true;
 			    	keypadFlagC=false;
 			    	keypadFlagD=false;
-			    	firstPressedB=false;
 					break;
 
 			//--------------------------- TEMPERATURE STATS -----------------------
 			case 2:
-					if(firstPressedC) lcd.cls();
-					lcd.setAddress(0,0);
-					lcd.printf("temperature menu");
+					lcd.showScreen(SCREEN_TEMP);
 					keypadFlagA=false;
 					keypadFlagB=false;
 			    	keypadFlagC=true;
 			    	keypadFlagD=false;
-			    	firstPressedC=false;
 					break;
 			//--------------------------- DRIVING ---------------------------------
 			case 3:
-					if(firstPressedD) lcd.cls();
-					lcd.setAddress(0,0);
-					lcd.printf("driving menu");
+					lcd.showScreen(SCREEN_DRIVING);
 					keypadFlagA=false;
 					keypadFlagB=false;
 			    	keypadFlagC=false;
 			    	keypadFlagD=true;
-			    	firstPressedD=false;
 					break;
 
 			default:
 				// main menu options
+				lcd.setScreen(SCREEN_HOME);
 				lcd.setAddress(0,1);
-				lcd.printf("Press to start ...");
+				lcdPrint(&lcd,"Press to start ...");
 				break;
 			}
     	keypadFlagA=false;
     	keypadFlagB=false;
     	keypadFlagC=false;
     	keypadFlagD=false;
+
+    	// only the cells that changed this pass go to the lcd
+    	lcd.flush();
     }
 
 /*
             if ( error ){
             	masterAlarm(lcd,1 ,&masterflag);
             	lcd.setAddress(2,0);
-            	lcd.printf("Water Temp HI");
+            	lcdPrint(&lcd,"Water Temp HI");
                 // function that holds up the loop until user presses a button.
-            	error=tempMode(&WaterTemp,&lcd,30);
+            	error=tempMode(&WaterTemp,&lcd,30*16);
             }
 
 */
@@ -237,22 +335,22 @@ int main() {
 
 void printIntro(void){
     
-    lcd.setUDC(0, (char *) udc_7);
+    int backslash=lcd.glyph(udc_7);
     
     lcd.setAddress(0,0);
-    lcd.printf("  (_)___ ___ ____ \n");
+    lcdPrint(&lcd,"  (_)___ ___ ____ \n");
     
-    lcd.printf("  | / -_) -_)  _ ");
-    lcd.putc(0);
-    lcd.printf("\n");
+    lcdPrint(&lcd,"  | / -_) -_)  _ ");
+    lcd.putc(backslash);
+    lcdPrint(&lcd,"\n");
     
-    lcd.printf(" _/ ");
-    lcd.putc(0);
-    lcd.printf("___");
-    lcd.putc(0);
-    lcd.printf("___| .__/\n");
+    lcdPrint(&lcd," _/ ");
+    lcd.putc(backslash);
+    lcdPrint(&lcd,"___");
+    lcd.putc(backslash);
+    lcdPrint(&lcd,"___| .__/\n");
     
-    lcd.printf("|__/        |_|   \n");
+    lcdPrint(&lcd,"|__/        |_|   \n");
     
 }    
   
@@ -261,20 +359,178 @@ void printIntro(void){
 void ScreenLoadinggps(void){
 
         lcd.setAddress(0,1);
-        lcd.printf("Loading Gps data   ");
+        lcdPrint(&lcd,"Loading Gps data   ");
         lcd.setAddress(0,2);
-        lcd.printf("     - No Fix -  ");
+        lcdPrint(&lcd,"     - No Fix -  ");
         lcd.setAddress(0,1);
-        lcd.printf("Loading Gps data.  ");
+        lcdPrint(&lcd,"Loading Gps data.  ");
+        lcd.flush();
         wait_ms(1000);
         lcd.setAddress(0,1);
-        lcd.printf("Loading Gps data.. ");
+        lcdPrint(&lcd,"Loading Gps data.. ");
+        lcd.flush();
         wait_ms(1000);
         lcd.setAddress(0,1);
-        lcd.printf("Loading Gps data...");
+        lcdPrint(&lcd,"Loading Gps data...");
+        lcd.flush();
         wait_ms(1000);    
 }
 
+// GPS screen
+//   14:05:09 18/10/2026
+//   Sat: 7
+//   Sp: 12.5kn Cp:181.25
+void ScreenGpsInit(void){
+
+	fieldInit(&gpsFields[GPS_HOUR],    0, 0, 2, 0, FORMAT_ZEROS);
+	fieldInit(&gpsFields[GPS_MINUTE],  3, 0, 2, 0, FORMAT_ZEROS);
+	fieldInit(&gpsFields[GPS_SECOND],  6, 0, 2, 0, FORMAT_ZEROS);
+	fieldInit(&gpsFields[GPS_DAY],     9, 0, 2, 0, FORMAT_ZEROS);
+	fieldInit(&gpsFields[GPS_MONTH],  12, 0, 2, 0, FORMAT_ZEROS);
+	fieldInit(&gpsFields[GPS_YEAR],   15, 0, 4, 0, FORMAT_ZEROS);
+	fieldInit(&gpsFields[GPS_SATS],    4, 1, 2, 0, 0);
+	fieldInit(&gpsFields[GPS_SPEED],   3, 2, 5, 1, 0);
+	fieldInit(&gpsFields[GPS_COURSE], 14, 2, 6, 2, 0);
+}
+
+// clears the screen and prints the text around the fields, the fields follow on the next update
+void ScreenGpsLabels(void){
+
+	int f;
+
+	lcd.cls();
+	lcd.setAddress(0,0);
+	lcdPrint(&lcd,"  :  :     /  /");
+	lcd.setAddress(0,1);
+	lcdPrint(&lcd,"Sat:");
+	lcd.setAddress(0,2);
+	lcdPrint(&lcd,"Sp:     kn Cp:");
+	for(f=0;f<GPS_FIELDS;f++)
+	{
+		fieldInvalidate(&gpsFields[f]);
+	}
+}
+
+void ScreenGps(GPS_Time *time,GPS_VTG *vector){
+
+	fieldUpdate(&gpsFields[GPS_HOUR], &lcd, time->hour);
+	fieldUpdate(&gpsFields[GPS_MINUTE], &lcd, time->minute);
+	fieldUpdate(&gpsFields[GPS_SECOND], &lcd, time->second);
+	fieldUpdate(&gpsFields[GPS_DAY], &lcd, time->day);
+	fieldUpdate(&gpsFields[GPS_MONTH], &lcd, time->month);
+	fieldUpdate(&gpsFields[GPS_YEAR], &lcd, time->year);
+	fieldUpdate(&gpsFields[GPS_SATS], &lcd, gps.numOfSats());
+	fieldUpdateFloat(&gpsFields[GPS_SPEED], &lcd, vector->_velocity_kph);
+	fieldUpdateFloat(&gpsFields[GPS_COURSE], &lcd, vector->_track_mag);
+}
+
+// Driving screen
+//   H2O  85.3' ..:|||:.  water temperature and its last samples
+//   ##############       water temperature gauge, WATER_GAUGE_MIN to WATER_TEMP_MAX
+//   Speed  62.4 km/h
+//   ########             speed gauge, 0 to SPEED_GAUGE_MAX km/h
+void ScreenDrivingInit(void){
+
+	fieldInit(&waterField, 3, 0, 6, 1, FORMAT_DEGREE);
+	sparkInit(&waterSpark, 10, 0, 10, 0, 0);
+	barInit(&waterBar, 0, 1, 20, WATER_GAUGE_MIN*16, WATER_TEMP_MAX*16);
+	fieldInit(&speedField, 6, 2, 5, 1, 0);
+	barInit(&speedBar, 0, 3, 20, 0, SPEED_GAUGE_MAX*10);
+}
+
+// clears the screen and prints the labels, the gauges follow on the next update
+void ScreenDrivingLabels(void){
+
+	lcd.cls();
+	lcd.setAddress(0,0);
+	lcdPrint(&lcd,"H2O");
+	lcd.setAddress(0,2);
+	lcdPrint(&lcd,"Speed");
+	lcd.setAddress(12,2);
+	lcdPrint(&lcd,"km/h");
+	fieldInvalidate(&waterField);
+	sparkInvalidate(&waterSpark);
+	barInvalidate(&waterBar);
+	fieldInvalidate(&speedField);
+	barInvalidate(&speedBar);
+}
+
+void ScreenDriving(GPS_VTG *vector){
+
+	short recent[STATS_RECENT];
+	int i;
+
+	if(WaterStats.valid)
+	{
+		fieldUpdate(&waterField, &lcd, tempTenths(WaterStats.last));
+		barUpdate(&waterBar, &lcd, WaterStats.last);
+		for(i=0;i<WaterStats.recentCount;i++)
+		{
+			recent[i]=statsRecent(&WaterStats, i);
+		}
+		sparkUpdate(&waterSpark, &lcd, recent, WaterStats.recentCount);
+	}
+	fieldUpdateFloat(&speedField, &lcd, vector->_velocity_kph);
+	barUpdate(&speedBar, &lcd, (long)(vector->_velocity_kph*10));
+}
+
+// Temperature stats, rendered from the precomputed window aggregates
+//   85.3' +0.4/m hi 12m     current, 10 min trend, time above threshold on this trip
+//   1m   84.9 85.0  101     min, mean, max per window, whole degrees from 100
+void ScreenTempStats(void){
+
+	char text[FORMAT_TEXT_SIZE];
+	int trend=WaterStats.tenMinutes.trend;
+	int aboveMinutes=WaterStats.trip.aboveMs/60000;
+
+	// keep every field to its width so row 0 stays within 20 columns
+	if(trend>TREND_LIMIT) trend=TREND_LIMIT;
+	if(trend<-TREND_LIMIT) trend=-TREND_LIMIT;
+	if(aboveMinutes>999) aboveMinutes=999;
+
+	if(!WaterStats.valid)
+	{
+		lcd.setAddress(0,0);
+		lcdPrint(&lcd,"Water temp: no data");
+		return;
+	}
+
+	lcd.setAddress(0,0);
+	lcdPrint(&lcd, formatTemp(text, WaterStats.last, 6, FORMAT_DEGREE));
+	lcdPrint(&lcd, " ");
+	lcdPrint(&lcd, formatTempFit(text, trend, 4, FORMAT_PLUS));
+	lcdPrint(&lcd, "/m hi");
+	lcdPrint(&lcd, formatInt(text, aboveMinutes, 3, 0));
+	lcdPrint(&lcd, "m");
+	lcd.setAddress(0,1);
+	printStatsRow("1m  ", &WaterStats.minute.total);
+	lcd.setAddress(0,2);
+	printStatsRow("10m ", &WaterStats.tenMinutes.total);
+	lcd.setAddress(0,3);
+	printStatsRow("Trip", &WaterStats.trip);
+}
+
+void printStatsRow(const char *label, const statsBucket *b){
+
+	char text[FORMAT_TEXT_SIZE];
+
+	if(b->count==0)
+	{
+		lcdPrint(&lcd, label);
+		lcdPrint(&lcd, " --.- --.- --.- ");
+		return;
+	}
+	// 4 wide with a blank in between, so 100 degrees and up can't run into the next value
+	lcdPrint(&lcd, label);
+	lcdPrint(&lcd, " ");
+	lcdPrint(&lcd, formatTempFit(text, b->min, 4, 0));
+	lcdPrint(&lcd, " ");
+	lcdPrint(&lcd, formatTempFit(text, statsMean(b), 4, 0));
+	lcdPrint(&lcd, " ");
+	lcdPrint(&lcd, formatTempFit(text, b->max, 4, 0));
+	lcdPrint(&lcd, " ");
+}
+
 uint32_t commandAfterInput(uint32_t index)
 {
 
@@ -284,6 +540,15 @@ uint32_t commandAfterInput(uint32_t index)
     return 0;
 }
 
+int readUptimeMs(void){
+
+	uptimeUs+=uptime.read_us();
+	uptime.reset();
+	uptimeMs+=uptimeUs/1000;
+	uptimeUs%=1000;		// keep the remainder so we don't drift
+	return uptimeMs;
+}
+
 void init(void){
 
 	// starting lcd backlight on initialization
@@ -291,6 +556,7 @@ void init(void){
 
     //JEEP INTRO
     printIntro();
+    lcd.flush();
     wait(JEEP_INTRO);
 
 }
@@ -0,0 +1,112 @@
+//
+//  sampling.cpp
+//  Mbed JEEP
+//
+//  Created by fmonpelat on 18/10/26.
+//  Copyright (c) 2026 ___FMONPELAT___. All rights reserved.
+//
+#include "mbed.h"
+#include "OneWire/OneWireThermometer.h"
+#include "OneWire/OneWireDefs.h"
+#include "sampling.h"
+
+// how close to the threshold (3 deg C) and how fast (6 deg C/min) counts as critical,
+// both in 1/16 deg C
+#define NEAR_MARGIN (3*16)
+#define FAST_RATE (6*16)
+#define LOWEST_TEMP -55		// DS18B20 range, so the low alarm never trips
+
+// resolution and sampling interval for each state
+#define CRITICAL_INTERVAL 1000
+#define WATCH_INTERVAL 2000
+#define QUIET_INTERVAL 5000
+#define SEARCH_INTERVAL QUIET_INTERVAL	// between searches for a missing sensor
+
+
+void samplerInit(tempSampler *s,OneWireThermometer *device,short alarmThreshold){
+
+	s->device=device;
+	s->alarmThreshold=alarmThreshold;
+	s->temperature=0;
+	s->rate=0;
+	s->resolution=twelveBit;		// power up resolution of the DS18B20
+	s->intervalMs=CRITICAL_INTERVAL;	// start fast until we know better
+	s->lastSampleMs=-CRITICAL_INTERVAL;
+	s->initialized=false;
+	s->valid=false;
+}
+
+// pick the resolution and interval for the next reading
+static void samplerSchedule(tempSampler *s){
+
+	int margin=s->alarmThreshold - s->temperature;
+	int rate=(s->rate < 0) ? -s->rate : s->rate;
+	eResolution resolution;
+
+	if(!s->valid || margin < NEAR_MARGIN || rate > FAST_RATE){
+		resolution=twelveBit;
+		s->intervalMs=CRITICAL_INTERVAL;
+	}
+	else if(margin < 2*NEAR_MARGIN || rate > FAST_RATE/2){
+		resolution=elevenBit;
+		s->intervalMs=WATCH_INTERVAL;
+	}
+	else{
+		resolution=nineBit;
+		s->intervalMs=QUIET_INTERVAL;
+	}
+
+	// writing the configuration costs a scratchpad read and write, only do it on change
+	if(resolution!=s->resolution){
+		s->device->setResolution(resolution);
+		s->resolution=resolution;
+	}
+}
+
+// The probe was unplugged or swapped: find and set it up again on the next
+// poll, and forget the old readings so the rate starts afresh.
+void samplerRescan(tempSampler *s){
+
+	s->initialized=false;
+	s->valid=false;
+	s->resolution=twelveBit;		// a new probe powers up at 12 bits
+	s->intervalMs=CRITICAL_INTERVAL;
+}
+
+// Take a reading if one is due. Returns true when a new reading was taken.
+bool samplerPoll(tempSampler *s,int nowMs){
+
+	short temp;
+	int elapsedMs=nowMs - s->lastSampleMs;
+
+	if(elapsedMs < s->intervalMs) return false;
+	s->lastSampleMs=nowMs;
+
+	if(!s->initialized){
+		// sensor not found yet, a search costs bus time so back off before the next one
+		if(!s->device->initialize()){
+			s->intervalMs=SEARCH_INTERVAL;
+			return false;
+		}
+		s->intervalMs=CRITICAL_INTERVAL;
+		s->device->setResolution(s->resolution);
+		// program the on-sensor alarm too, so findAlarms() can spot it without a read
+		s->device->setAlarms((signed char)(s->alarmThreshold/16),LOWEST_TEMP);
+		s->initialized=true;
+	}
+
+	temp=s->device->readTemperatureFixed();
+	if(temp==TEMPERATURE_INVALID) return false;
+
+	if(s->valid){
+		// smooth the rate over a couple of readings so one noisy LSB doesn't upset it
+		int rate=(temp - s->temperature)*60000/elapsedMs;
+		s->rate=(s->rate + rate)/2;
+	}
+	s->temperature=temp;
+	s->valid=true;
+
+	samplerSchedule(s);
+
+	return true;
+}
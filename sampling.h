@@ -0,0 +1,38 @@
+/*
+ * sampling.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: fmonpelat
+ */
+
+#ifndef SAMPLING_H_
+#define SAMPLING_H_
+
+#include "OneWire/OneWireThermometer.h"
+
+// Adaptive temperature sampling: each sensor is read at the lowest
+// resolution and rate that its state allows. A stable reading far from
+// its alarm threshold is taken at 9 bits (94 ms conversion) every few
+// seconds, a reading close to the threshold or changing fast at 12 bits
+// (750 ms conversion) every second.
+
+typedef struct {
+	OneWireThermometer *device;
+	short alarmThreshold;		// 1/16 deg C
+	short temperature;			// last good reading, 1/16 deg C
+	int rate;					// smoothed rate of change, 1/16 deg C per minute
+	eResolution resolution;		// resolution the sensor is set to
+	int intervalMs;				// time between readings
+	int lastSampleMs;			// time of the last reading
+	bool initialized;			// sensor found and addressed
+	bool valid;					// temperature holds a good reading
+} tempSampler;
+
+//Prototypes
+
+void samplerInit(tempSampler *,OneWireThermometer *,short);
+bool samplerPoll(tempSampler *,int);
+void samplerRescan(tempSampler *);
+
+
+#endif /* SAMPLING_H_ */
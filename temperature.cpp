@@ -10,39 +10,69 @@
 #include "OneWire/DS18B20.h"
 #include "OneWire/OneWireDefs.h"
 #include "temperature.h"
+#include "lcdformat.h"
 
 
 
-bool tempMode(DS18B20 *device,TextLCD_I2C *lcd,float max_temp){
+bool tempMode(DS18B20 *device,TextLCD_I2C *lcd,short max_temp){
 
-        float temp;
+        short temp;
+        char text[FORMAT_TEXT_SIZE];
 
-        while (!(*device).initialize());    // keep calling until it works
+        while (!(*device).initialize()) wait(2);    // keep calling until it works
         (*device).setResolution(twelveBit);
 
-            temp=(*device).readTemperature();
+            temp=(*device).readTemperatureFixed();
             //lcd.cls();
             (*lcd).setAddress(0,2);
-            (*lcd).printf("H2O Temp: %.1f",temp);
-            (*lcd).putc(223);
+            lcdPrint(lcd,"H2O Temp: ");
+            if(temp==TEMPERATURE_INVALID) lcdPrint(lcd,"--.-");
+            else lcdPrint(lcd,formatTemp(text,temp,0,FORMAT_DEGREE));
             wait(0.2);
-            if(temp>max_temp){
+            if(temp!=TEMPERATURE_INVALID && temp>max_temp){
                 return true;
             }
             return false;
 }
 
 
-bool getTemp(DS18B20 *device,float maxThreshold,float *temp){
+bool getTemp(DS18B20 *device,short maxThreshold,short *temp){
 
 
-        while (!(*device).initialize());    // keep calling until it works
+        while (!(*device).initialize()) wait(2);    // keep calling until it works
         (*device).setResolution(twelveBit);
 
-            *temp=(*device).readTemperature();
+            *temp=(*device).readTemperatureFixed();
 
-            if(*temp>maxThreshold){
+            if(*temp!=TEMPERATURE_INVALID && *temp>maxThreshold){
                 return true;
             }
             return false;
 }
+
+// Format a 1/16 deg C value with one decimal, rounded, without touching
+// float. width and the FORMAT_ flags are as for formatFixed(), FORMAT_PLUS
+// for rates of change, FORMAT_DEGREE to add the degree sign.
+char *formatTemp(char *text,int value,int width,int flags){
+
+        return formatFixed(text,tempTenths(value),1,width,flags);
+}
+
+// As formatTemp(), but whole degrees when the decimal doesn't fit in width,
+// e.g. width 4 gives "85.3" and " 101", so columns of values stay apart.
+char *formatTempFit(char *text,int value,int width,int flags){
+
+        long tenths=tempTenths(value);
+
+        if(formatLength(tenths,1,flags)<=width) return formatFixed(text,tenths,1,width,flags);
+
+        tenths+=(tenths<0) ? -5 : 5;
+        return formatFixed(text,tenths/10,0,width,flags);
+}
+
+// 1/16 -> 1/10 deg C, the magnitude rounded so it is the same either side of 0
+long tempTenths(int value){
+
+        if(value<0) return -(long)((-value*10 + 8)/16);
+        return (value*10 + 8)/16;
+}
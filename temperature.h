@@ -11,10 +11,16 @@
 #define TEMPERATURE_H_
 
 
+// Temperatures are fixed point, 1/16 deg C, as read from the DS18B20.
+// The formatTemp() text goes to a FORMAT_TEXT_SIZE buffer (lcdformat.h).
+
 //Prototypes
 
-bool tempMode(DS18B20 *,TextLCD_I2C *,float);//deprecated
-bool getTemp(DS18B20 *,float ,float *);
+bool tempMode(DS18B20 *,TextLCD_I2C *,short);//deprecated
+bool getTemp(DS18B20 *,short ,short *);
+long tempTenths(int);
+char *formatTemp(char *,int ,int ,int);
+char *formatTempFit(char *,int ,int ,int);
 
 
 
@@ -0,0 +1,154 @@
+//
+//  tempstats.cpp
+//  Mbed JEEP
+//
+//  Created by fmonpelat on 18/10/26.
+//  Copyright (c) 2026 ___FMONPELAT___. All rights reserved.
+//
+#include "tempstats.h"
+
+
+static void bucketClear(statsBucket *b){
+
+	b->min=0x7FFF;
+	b->max=-0x7FFF;
+	b->sum=0;
+	b->count=0;
+	b->aboveMs=0;
+}
+
+// merge b into a
+static void bucketMerge(statsBucket *a,const statsBucket *b){
+
+	if(b->min < a->min) a->min=b->min;
+	if(b->max > a->max) a->max=b->max;
+	a->sum+=b->sum;
+	a->count+=b->count;
+	a->aboveMs+=b->aboveMs;
+}
+
+static void bucketAdd(statsBucket *b,short value,int aboveMs){
+
+	if(value < b->min) b->min=value;
+	if(value > b->max) b->max=value;
+	b->sum+=value;
+	b->count++;
+	b->aboveMs+=aboveMs;
+}
+
+static void windowInit(statsWindow *w,int bucketMs,int nowMs){
+
+	w->bucketMs=bucketMs;
+	w->bucketStartMs=nowMs;
+	w->current=0;
+	for(int i=0;i<STATS_BUCKETS;i++) bucketClear(&w->buckets[i]);
+	bucketClear(&w->past);
+	bucketClear(&w->total);
+	w->trend=0;
+}
+
+// close the open bucket(s) and recompute the aggregate of the closed ones
+static void windowRoll(statsWindow *w,int nowMs){
+
+	int steps=0;
+	int oldest=-1;
+	int newest=-1;
+
+	while(nowMs - w->bucketStartMs >= w->bucketMs && steps < STATS_BUCKETS){
+		w->current=(w->current + 1) % STATS_BUCKETS;
+		bucketClear(&w->buckets[w->current]);
+		w->bucketStartMs+=w->bucketMs;
+		steps++;
+	}
+	// a long gap clears the whole window
+	if(nowMs - w->bucketStartMs >= w->bucketMs) w->bucketStartMs=nowMs;
+
+	bucketClear(&w->past);
+	for(int i=1;i<STATS_BUCKETS;i++){
+		// walk the closed buckets from oldest to newest
+		int idx=(w->current + i) % STATS_BUCKETS;
+		if(w->buckets[idx].count==0) continue;
+		bucketMerge(&w->past,&w->buckets[idx]);
+		if(oldest<0) oldest=i;
+		newest=i;
+	}
+	w->total=w->past;
+
+	// trend from the mean of the oldest to the newest closed bucket
+	if(oldest>=0 && newest>oldest){
+		int from=statsMean(&w->buckets[(w->current + oldest) % STATS_BUCKETS]);
+		int to=statsMean(&w->buckets[(w->current + newest) % STATS_BUCKETS]);
+		w->trend=(to - from)*60000/((newest - oldest)*w->bucketMs);
+	}
+	else w->trend=0;
+}
+
+static void windowAdd(statsWindow *w,short value,int aboveMs,int nowMs){
+
+	if(nowMs - w->bucketStartMs >= w->bucketMs) windowRoll(w,nowMs);
+
+	bucketAdd(&w->buckets[w->current],value,aboveMs);
+
+	// the open bucket only grows, so the window aggregate can be updated in place
+	if(value < w->total.min) w->total.min=value;
+	if(value > w->total.max) w->total.max=value;
+	w->total.sum+=value;
+	w->total.count++;
+	w->total.aboveMs+=aboveMs;
+}
+
+
+void statsInit(tempStats *s,short threshold){
+
+	s->threshold=threshold;
+	s->last=0;
+	s->lastMs=0;
+	s->valid=false;
+	s->recentHead=0;
+	s->recentCount=0;
+	windowInit(&s->minute,6000,0);			// 10 x 6 s
+	windowInit(&s->tenMinutes,60000,0);		// 10 x 1 min
+	bucketClear(&s->trip);
+}
+
+// Add a sample taken at nowMs. The time since the previous sample counts
+// as above the threshold when the previous sample was above it.
+void statsAdd(tempStats *s,short value,int nowMs){
+
+	int aboveMs=0;
+
+	if(!s->valid){
+		// start the windows at the first sample
+		windowInit(&s->minute,6000,nowMs);
+		windowInit(&s->tenMinutes,60000,nowMs);
+	}
+	else if(s->last > s->threshold){
+		aboveMs=nowMs - s->lastMs;
+	}
+
+	windowAdd(&s->minute,value,aboveMs,nowMs);
+	windowAdd(&s->tenMinutes,value,aboveMs,nowMs);
+	bucketAdd(&s->trip,value,aboveMs);
+
+	s->recent[s->recentHead]=value;
+	s->recentHead=(s->recentHead + 1) % STATS_RECENT;
+	if(s->recentCount < STATS_RECENT) s->recentCount++;
+
+	s->last=value;
+	s->lastMs=nowMs;
+	s->valid=true;
+}
+
+// mean of a bucket or window aggregate, 1/16 deg C
+int statsMean(const statsBucket *b){
+
+	if(b->count==0) return 0;
+	return b->sum/b->count;
+}
+
+// recent sample, 0 is the oldest kept, recentCount-1 the newest
+short statsRecent(const tempStats *s,int i){
+
+	int oldest=(s->recentHead - s->recentCount + STATS_RECENT) % STATS_RECENT;
+	return s->recent[(oldest + i) % STATS_RECENT];
+}
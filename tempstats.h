@@ -0,0 +1,58 @@
+/*
+ * tempstats.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: fmonpelat
+ */
+
+#ifndef TEMPSTATS_H_
+#define TEMPSTATS_H_
+
+// Rolling temperature statistics. Samples are fixed point, 1/16 deg C
+// (the DS18B20 native format). Every window is a ring of buckets: adding
+// a sample updates the open bucket and the window aggregate in O(1), and
+// when a bucket closes the aggregate of the others is recomputed once
+// (O(STATS_BUCKETS)). The screens only read the aggregates.
+
+#define STATS_BUCKETS 10	// buckets per window, the window spans 9..10 buckets
+#define STATS_RECENT 20		// raw samples kept, one per LCD column
+
+typedef struct {
+	short min;			// 1/16 deg C
+	short max;			// 1/16 deg C
+	int sum;			// 1/16 deg C
+	int count;			// samples
+	int aboveMs;		// time spent above the threshold
+} statsBucket;
+
+typedef struct {
+	int bucketMs;					// duration of one bucket
+	int bucketStartMs;				// start time of the open bucket
+	int current;					// index of the open bucket
+	statsBucket buckets[STATS_BUCKETS];
+	statsBucket past;				// aggregate of the closed buckets
+	statsBucket total;				// aggregate of the whole window
+	int trend;						// 1/16 deg C per minute
+} statsWindow;
+
+typedef struct {
+	short threshold;				// 1/16 deg C
+	short last;						// last sample, 1/16 deg C
+	int lastMs;						// time of the last sample
+	bool valid;						// at least one sample added
+	short recent[STATS_RECENT];		// ring of the last samples
+	int recentHead;					// next slot to write in recent
+	int recentCount;
+	statsWindow minute;				// last minute
+	statsWindow tenMinutes;			// last ten minutes
+	statsBucket trip;				// since power up
+} tempStats;
+
+//Prototypes
+
+void statsInit(tempStats *,short);
+void statsAdd(tempStats *,short,int);
+int statsMean(const statsBucket *);
+short statsRecent(const tempStats *,int);
+
+#endif /* TEMPSTATS_H_ */
@@ -0,0 +1,192 @@
+//
+//  widgets.cpp
+//  Mbed JEEP
+//
+//  Created by fmonpelat on 18/10/26.
+//  Copyright (c) 2026 ___FMONPELAT___. All rights reserved.
+//
+#include "mbed.h"
+#include <math.h>
+#include "TextLCD.h"
+#include "widgets.h"
+
+
+void fieldInit(lcdField *f,int column,int row,int width,int decimals,int flags){
+
+	if(width>FIELD_TEXT_SIZE-1) width=FIELD_TEXT_SIZE-1;
+
+	f->column=column;
+	f->row=row;
+	f->width=width;
+	f->decimals=decimals;
+	f->flags=flags;
+	f->shown=0;
+	f->valid=false;
+}
+
+// the screen under the field was cleared or overwritten, show it again on the next update
+void fieldInvalidate(lcdField *f){
+
+	f->valid=false;
+}
+
+// value in steps of 10^-decimals, returns true when the field was sent to the lcd
+bool fieldUpdate(lcdField *f,TextLCD_Base *lcd,long steps){
+
+	char text[FIELD_TEXT_SIZE];
+	int i;
+	bool end=false;
+
+	// same step as on the screen, the text wouldn't change
+	if(f->valid && steps==f->shown) return false;
+
+	f->shown=steps;
+	f->valid=true;
+
+	formatFixed(text,steps,f->decimals,f->width,f->flags);
+
+	lcd->setAddress(f->column,f->row);
+	for(i=0;i<f->width;i++)
+	{
+		if(!text[i]) end=true;
+		lcd->putc(end ? ' ' : text[i]);
+	}
+	return true;
+}
+
+// for values that come as floating point, rounded to the field's steps
+bool fieldUpdateFloat(lcdField *f,TextLCD_Base *lcd,double value){
+
+	double scale=1;
+	int i;
+
+	for(i=0;i<f->decimals;i++) scale*=10;
+	return fieldUpdate(f,lcd,(long)floor(value*scale + 0.5));
+}
+
+// the partial cells of a bar, 1..5 fifths
+static const char *barGlyphs[5]={ udc_bar_1, udc_bar_2, udc_bar_3, udc_bar_4, udc_bar_5 };
+
+// sparkline columns 2, 4 and 6 pixels high, the 8 pixel one is the ROM block
+static const char sparkGlyph2[8]={ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F };
+static const char sparkGlyph4[8]={ 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F };
+static const char sparkGlyph6[8]={ 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F };
+#define SPARK_BLOCK 0xFF
+
+void barInit(lcdBar *b,int column,int row,int width,long low,long high){
+
+	b->column=column;
+	b->row=row;
+	b->width=width;
+	b->low=low;
+	b->high=high;
+	b->shown=0;
+	b->valid=false;
+}
+
+void barInvalidate(lcdBar *b){
+
+	b->valid=false;
+}
+
+// returns true when cells were sent to the lcd
+bool barUpdate(lcdBar *b,TextLCD_Base *lcd,long value){
+
+	long range=b->high - b->low;
+	int fifths,from,to,cell,lit;
+
+	if(value<b->low) value=b->low;
+	if(value>b->high) value=b->high;
+	fifths=(range>0) ? ((value - b->low)*b->width*5 + range/2)/range : 0;
+
+	if(b->valid && fifths==b->shown) return false;
+
+	// the cells between the old and the new end, or all of them
+	if(b->valid){
+		from=((fifths<b->shown) ? fifths : b->shown)/5;
+		to=(((fifths>b->shown) ? fifths : b->shown) - 1)/5;
+		if(to>=b->width) to=b->width-1;
+	}
+	else{
+		from=0;
+		to=b->width-1;
+	}
+
+	lcd->setAddress(b->column+from,b->row);
+	for(cell=from;cell<=to;cell++)
+	{
+		lit=fifths - cell*5;
+		if(lit<=0) lcd->putc(' ');
+		else lcd->putc(lcd->glyph(barGlyphs[(lit>5) ? 4 : lit-1]));
+	}
+
+	b->shown=fifths;
+	b->valid=true;
+	return true;
+}
+
+void sparkInit(lcdSpark *s,int column,int row,int width,long low,long high){
+
+	if(width>SPARK_WIDTH) width=SPARK_WIDTH;
+
+	s->column=column;
+	s->row=row;
+	s->width=width;
+	s->low=low;
+	s->high=high;
+	s->valid=false;
+}
+
+void sparkInvalidate(lcdSpark *s){
+
+	s->valid=false;
+}
+
+// values oldest first, the last width of them are drawn with the newest on
+// the right. Returns true when cells were sent to the lcd.
+bool sparkUpdate(lcdSpark *s,TextLCD_Base *lcd,const short *values,int count){
+
+	long low=s->low,high=s->high;
+	int first=count - s->width;		// value in the first cell, blank cells in front when negative
+	int cell,height,next=-1;
+	bool sent=false;
+
+	if(low>=high){
+		low=high=(count>0) ? values[count-1] : 0;
+		for(cell=(first>0) ? first : 0;cell<count;cell++)
+		{
+			if(values[cell]<low) low=values[cell];
+			if(values[cell]>high) high=values[cell];
+		}
+		if(low==high) high=low+1;
+	}
+
+	for(cell=0;cell<s->width;cell++)
+	{
+		if(first+cell<0){
+			height=0;
+		}
+		else{
+			long value=values[first+cell];
+			if(value<low) value=low;
+			if(value>high) value=high;
+			height=1 + ((value-low)*3 + (high-low)/2)/(high-low);
+		}
+		if(s->valid && height==s->shown[cell]) continue;
+
+		s->shown[cell]=height;
+		if(cell!=next) lcd->setAddress(s->column+cell,s->row);
+		switch(height){
+			case 0: lcd->putc(' '); break;
+			case 1: lcd->putc(lcd->glyph(sparkGlyph2)); break;
+			case 2: lcd->putc(lcd->glyph(sparkGlyph4)); break;
+			case 3: lcd->putc(lcd->glyph(sparkGlyph6)); break;
+			default: lcd->putc(SPARK_BLOCK); break;
+		}
+		next=cell+1;
+		sent=true;
+	}
+
+	s->valid=true;
+	return sent;
+}
@@ -0,0 +1,78 @@
+/*
+ * widgets.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: fmonpelat
+ */
+
+#ifndef WIDGETS_H_
+#define WIDGETS_H_
+
+#include "TextLCD.h"
+#include "lcdformat.h"
+
+// Value fields for the LCD screens. A field has a fixed place and width
+// on the screen and remembers the value it last showed, in steps of its
+// display resolution: fieldUpdate() only formats and sends the text when
+// the value moved to another step, so a screen costs what changes on it.
+// Labels around the fields are printed once when the screen is entered.
+// Values are fixed point, in steps of 10^-decimals, and are formatted
+// with formatFixed().
+
+#define FIELD_TEXT_SIZE FORMAT_TEXT_SIZE	// widest field, one LCD row, plus the terminator
+
+typedef struct {
+	char column;
+	char row;
+	char width;				// characters, the text is padded or cut to it
+	char decimals;			// digits after the point
+	char flags;				// FORMAT_ flags for formatFixed()
+	long shown;				// value on the screen, in steps of 10^-decimals
+	bool valid;				// shown holds what is on the screen
+} lcdField;
+
+// Bar graphs, filled from the left in fifths of a cell with the udc_bar_1..5
+// glyphs, so a 20 cell bar has 100 steps. barUpdate() only rewrites the
+// cells between the old and the new end of the bar, one or two when the
+// value moves a little.
+
+typedef struct {
+	char column;
+	char row;
+	char width;				// cells
+	long low;				// value of the empty bar
+	long high;				// value of the full bar
+	int shown;				// fifths of a cell lit on the screen
+	bool valid;				// shown holds what is on the screen
+} lcdBar;
+
+// Sparklines, one sample per cell drawn as a column 2, 4, 6 or 8 pixels
+// high. That takes 3 glyphs and the ROM block, so a sparkline fits the
+// 8 UDCs next to the 5 of the bars. Cells without a sample are blank.
+
+#define SPARK_WIDTH (FIELD_TEXT_SIZE-1)
+
+typedef struct {
+	char column;
+	char row;
+	char width;				// cells, at most SPARK_WIDTH
+	long low;				// value of the lowest column, low==high scales to the samples shown
+	long high;				// value of the highest column
+	char shown[SPARK_WIDTH];	// height of each column on the screen, 0 when blank
+	bool valid;				// shown holds what is on the screen
+} lcdSpark;
+
+//Prototypes
+
+void fieldInit(lcdField *,int,int,int,int,int);
+void fieldInvalidate(lcdField *);
+bool fieldUpdate(lcdField *,TextLCD_Base *,long);
+bool fieldUpdateFloat(lcdField *,TextLCD_Base *,double);
+void barInit(lcdBar *,int,int,int,long,long);
+void barInvalidate(lcdBar *);
+bool barUpdate(lcdBar *,TextLCD_Base *,long);
+void sparkInit(lcdSpark *,int,int,int,long,long);
+void sparkInvalidate(lcdSpark *);
+bool sparkUpdate(lcdSpark *,TextLCD_Base *,const short *,int);
+
+#endif /* WIDGETS_H_ */